@@ -0,0 +1,112 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <QDebug>
+
+#include "AsyncMouse.h"
+
+namespace CMS {
+
+AsyncMouse::AsyncMouse(IMouse *mouse) :
+    mouse(mouse),
+    running(true)
+{
+    start();
+}
+
+AsyncMouse::~AsyncMouse()
+{
+    mutex.lock();
+    running = false;
+    eventAvailable.wakeOne();
+    mutex.unlock();
+    wait();
+    delete mouse;
+}
+
+void AsyncMouse::move(double x, double y)
+{
+    mouse->move(x, y);
+}
+
+void AsyncMouse::click()
+{
+    post(MOUSE_CLICK);
+}
+
+void AsyncMouse::press()
+{
+    post(MOUSE_PRESS);
+}
+
+void AsyncMouse::release()
+{
+    post(MOUSE_RELEASE);
+}
+
+void AsyncMouse::post(MouseButtonEvent event)
+{
+    QMutexLocker locker(&mutex);
+    events.push(event);
+    eventAvailable.wakeOne();
+}
+
+// Pending events are still delivered after stopping, so a press is never left
+// without its release
+bool AsyncMouse::waitForEvent(MouseButtonEvent &event)
+{
+    QMutexLocker locker(&mutex);
+    while (events.empty())
+    {
+        if (!running)
+            return false;
+        eventAvailable.wait(&mutex);
+    }
+    event = events.front();
+    events.pop();
+    return true;
+}
+
+void AsyncMouse::run()
+{
+    MouseButtonEvent event;
+    while (waitForEvent(event))
+    {
+        try
+        {
+            switch (event)
+            {
+            case MOUSE_CLICK:
+                mouse->click();
+                break;
+            case MOUSE_PRESS:
+                mouse->press();
+                break;
+            case MOUSE_RELEASE:
+                mouse->release();
+                break;
+            }
+        }
+        catch (std::exception &e)
+        {
+            qWarning() << "Mouse event could not be injected:" << e.what();
+        }
+    }
+}
+
+} // namespace CMS
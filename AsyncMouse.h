@@ -0,0 +1,66 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_ASYNCMOUSE_H
+#define CMS_ASYNCMOUSE_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <queue>
+
+#include "Mouse.h"
+
+namespace CMS {
+
+enum MouseButtonEvent
+{
+    MOUSE_CLICK,
+    MOUSE_PRESS,
+    MOUSE_RELEASE
+};
+
+// Forwards pointer motion straight to the wrapped mouse but queues button
+// events to a worker thread, so any delay needed to synthesize them (e.g.
+// holding the button down) is spent there instead of on the caller's thread.
+class AsyncMouse : public QThread, public IMouse
+{
+public:
+    explicit AsyncMouse(IMouse *mouse); // Takes ownership
+    ~AsyncMouse();
+    void move(double x, double y);
+    void click();
+    void press();
+    void release();
+
+protected:
+    void run();
+
+private:
+    IMouse *mouse;
+    std::queue<MouseButtonEvent> events;
+    QMutex mutex;
+    QWaitCondition eventAvailable;
+    bool running;
+
+    void post(MouseButtonEvent event);
+    bool waitForEvent(MouseButtonEvent &event);
+};
+
+} // namespace CMS
+
+#endif // CMS_ASYNCMOUSE_H
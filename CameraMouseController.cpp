@@ -21,75 +21,208 @@
 #endif
 
 #include "CameraMouseController.h"
+#include "Profiler.h"
 
 namespace CMS {
 
 CameraMouseController::CameraMouseController(Settings &settings, ITrackingModule *trackingModule, MouseControlModule *controlModule) :
-    settings(settings), trackingModule(trackingModule), controlModule(controlModule)
+    settings(settings), trackingModule(trackingModule), controlModule(controlModule),
+    pendingTrackingModule(0)
 {
-    featureCheckTimer.start();
+    trackingModule->setBufferPool(&bufferPool);
 }
 
 CameraMouseController::~CameraMouseController()
 {
     delete trackingModule;
+    delete pendingTrackingModule;
     delete controlModule;
 }
 
-void CameraMouseController::processFrame(cv::Mat &frame)
+// Frames are processed as delivered by the camera, positions are only
+// mirrored when they are passed on to the mouse or compared to clicks
+void CameraMouseController::processFrame(cv::Mat &frame, qint64 captureTime)
 {
-    prevFrame = frame;
+    ScopedStageTimer frameTimer(STAGE_FRAME);
+    frameSize = frame.size();
+    applyPendingTrackingModule(frame, captureTime);
+    lastFeaturePosition = Point();
+    applyPendingClick(frame, captureTime);
 
     if (trackingModule->isInitialized())
     {
-        Point featurePosition = trackingModule->track(frame);
-        if (!featurePosition.empty())
+        TrackResult result;
+        {
+            ScopedStageTimer trackTimer(STAGE_TRACK);
+            result = trackingModule->track(frame);
+        }
+        Point featurePosition = result.position;
+        if (settings.isAutoDetectNoseEnabled())
         {
-            if (settings.isAutoDetectNoseEnabled() && featureCheckTimer.elapsed() > 1000)
+            Point autoFeaturePosition;
+            Point snapshotFeaturePosition; // Tracked when the frame detected on was taken
+            if (detectionWorker.takeResult(autoFeaturePosition, snapshotFeaturePosition))
             {
-                Point autoFeaturePosition = initializationModule.initializeFeature(frame);
+                detectionScheduler.detectionDone(!autoFeaturePosition.empty(), captureTime);
+                // The feature kept moving while the detection ran on the snapshot,
+                // the detected position moves with it
+                if (!autoFeaturePosition.empty() && !featurePosition.empty() && !snapshotFeaturePosition.empty())
+                    autoFeaturePosition = autoFeaturePosition + (featurePosition - snapshotFeaturePosition);
                 if (!autoFeaturePosition.empty())
                 {
                     double distThreshSq = settings.getResetFeatureDistThreshSq();
                     Point disp = autoFeaturePosition - featurePosition;
-                    if (disp * disp > distThreshSq)
+                    if (result.lost || !detectionScheduler.isConfident() || disp * disp > distThreshSq)
                     {
                         trackingModule->setTrackPoint(frame, autoFeaturePosition);
                         controlModule->setScreenReference(controlModule->getPrevPos());
                         controlModule->restart();
                         featurePosition = autoFeaturePosition;
                     }
-                    featureCheckTimer.restart();
                 }
             }
-            trackingModule->drawOnFrame(frame, featurePosition);
-            controlModule->update(featurePosition);
+            // The detection only runs when the tracker is unsure of the feature or
+            // has not been checked for a while, and not while one is running
+            if (detectionScheduler.shouldDetect(result, captureTime) && detectionWorker.post(frame, featurePosition))
+                detectionScheduler.detectionStarted();
+        }
+        if (!featurePosition.empty())
+        {
+            lastFeaturePosition = featurePosition;
+            controlModule->update(flip.apply(featurePosition, frame.size()), captureTime);
         }
     }
     else if (settings.isAutoDetectNoseEnabled())
     {
-        Point initialFeaturePosition = initializationModule.initializeFeature(frame);
-        if (!initialFeaturePosition.empty())
+        // Without a feature to move with, the detection is used as it is
+        Point initialFeaturePosition;
+        Point snapshotFeaturePosition;
+        bool detected = detectionWorker.takeResult(initialFeaturePosition, snapshotFeaturePosition);
+        // A synchronous detection is done as soon as it is posted
+        if (!detected && detectionWorker.post(frame))
+            detected = detectionWorker.takeResult(initialFeaturePosition, snapshotFeaturePosition);
+        if (detected && !initialFeaturePosition.empty())
         {
             trackingModule->setTrackPoint(frame, initialFeaturePosition);
             controlModule->setScreenReference(settings.getScreenResolution()/2);
             controlModule->restart();
+            detectionScheduler.restart(captureTime);
         }
     }
 }
 
 void CameraMouseController::processClick(Point position)
 {
-    if (!prevFrame.empty())
+    QMutexLocker locker(&clickMutex);
+    pendingClick = position;
+}
+
+// A detection started before the click would override the point the user
+// just chose, so it is dropped
+void CameraMouseController::applyPendingClick(cv::Mat &frame, qint64 captureTime)
+{
+    Point position;
+    clickMutex.lock();
+    position = pendingClick;
+    pendingClick = Point();
+    clickMutex.unlock();
+
+    if (!position.empty())
     {
-        trackingModule->setTrackPoint(prevFrame, position);
+        trackingModule->setTrackPoint(frame, flip.apply(position, frame.size()));
         controlModule->restart();
+        detectionWorker.discardResults();
+        detectionScheduler.restart(captureTime);
     }
 }
 
+void CameraMouseController::setTrackingModule(ITrackingModule *trackingModule)
+{
+    QMutexLocker locker(&trackingModuleMutex);
+    delete pendingTrackingModule;
+    pendingTrackingModule = trackingModule;
+}
+
+// The new module carries on from where the feature was seen last
+void CameraMouseController::applyPendingTrackingModule(cv::Mat &frame, qint64 captureTime)
+{
+    ITrackingModule *newModule;
+    trackingModuleMutex.lock();
+    newModule = pendingTrackingModule;
+    pendingTrackingModule = 0;
+    trackingModuleMutex.unlock();
+
+    if (!newModule)
+        return;
+    newModule->setBufferPool(&bufferPool);
+    if (trackingModule->isInitialized() && !lastFeaturePosition.empty())
+    {
+        newModule->setTrackPoint(frame, lastFeaturePosition);
+        detectionWorker.discardResults();
+        detectionScheduler.restart(captureTime);
+    }
+    delete trackingModule;
+    trackingModule = newModule;
+}
+
+void CameraMouseController::drawOnPreview(cv::Mat &preview)
+{
+    ScopedStageTimer timer(STAGE_DRAW);
+    if (lastFeaturePosition.empty() || frameSize.width == 0)
+        return;
+    double scale = (double) preview.cols / frameSize.width;
+    trackingModule->drawOnFrame(preview, flip.apply(lastFeaturePosition, frameSize) * scale);
+}
+
 bool CameraMouseController::isAutoDetectWorking()
 {
-    return initializationModule.allFilesLoaded();
+    return detectionWorker.allFilesLoaded();
+}
+
+void CameraMouseController::setFrameFlip(FrameFlip flip)
+{
+    this->flip = flip;
+    detectionWorker.setFrameFlip(flip);
+}
+
+FrameFlip CameraMouseController::getFrameFlip()
+{
+    return flip;
+}
+
+FrameBufferPool &CameraMouseController::getBufferPool()
+{
+    return bufferPool;
+}
+
+void CameraMouseController::getDetectionPoolAllocations(int &allocations, int &detectionsWithAllocations)
+{
+    detectionWorker.getPoolAllocations(allocations, detectionsWithAllocations);
+}
+
+void CameraMouseController::setAsynchronousDetection(bool enabled)
+{
+    detectionWorker.setSynchronous(!enabled);
+}
+
+void CameraMouseController::setLocalFaceSearch(bool enabled)
+{
+    detectionWorker.setLocalFaceSearch(enabled);
+}
+
+void CameraMouseController::setHistogramEqualization(bool enabled)
+{
+    detectionWorker.setHistogramEqualization(enabled);
+}
+
+DetectionScheduler &CameraMouseController::getDetectionScheduler()
+{
+    return detectionScheduler;
+}
+
+LatencyHistogram &CameraMouseController::getLatencyHistogram()
+{
+    return controlModule->getLatencyHistogram();
 }
 
 } // namespace CMS
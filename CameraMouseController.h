@@ -19,9 +19,13 @@
 #define CMS_CAMERAMOUSECONTROLLER_H
 
 #include <cv.h>
-#include <QTime>
+#include <QMutex>
 
-#include "FeatureInitializationModule.h"
+#include "DetectionScheduler.h"
+#include "FeatureDetectionWorker.h"
+#include "FrameBufferPool.h"
+#include "FrameFlip.h"
+#include "LatencyHistogram.h"
 #include "TrackingModule.h"
 #include "MouseControlModule.h"
 #include "Point.h"
@@ -34,17 +38,42 @@ class CameraMouseController
 public:
     CameraMouseController(Settings &settings, ITrackingModule *trackingModule, MouseControlModule *controlModule);
     ~CameraMouseController();
-    void processFrame(cv::Mat &frame);
-    void processClick(Point position);
+    void processFrame(cv::Mat &frame, qint64 captureTime); // captureTime from Clock::nowMicros()
+    void processClick(Point position); // May be called from any thread, applied to the next frame
+    void setTrackingModule(ITrackingModule *trackingModule); // Takes ownership, same as processClick
+    void drawOnPreview(cv::Mat &preview);
     bool isAutoDetectWorking();
+    void setFrameFlip(FrameFlip flip);
+    FrameFlip getFrameFlip();
+    FrameBufferPool &getBufferPool();
+    // The detection has its own pool, it runs on another thread
+    void getDetectionPoolAllocations(int &allocations, int &detectionsWithAllocations);
+    LatencyHistogram &getLatencyHistogram();
+    DetectionScheduler &getDetectionScheduler();
+    // Detection runs on its own thread by default
+    void setAsynchronousDetection(bool enabled);
+    // Once a face was found, detections first search near it (enabled by default)
+    void setLocalFaceSearch(bool enabled);
+    // Equalizes the faces before their features are searched (disabled by default)
+    void setHistogramEqualization(bool enabled);
 
 private:
     Settings &settings;
-    FeatureInitializationModule initializationModule;
+    FrameBufferPool bufferPool;
+    FeatureDetectionWorker detectionWorker;
     ITrackingModule *trackingModule;
     MouseControlModule *controlModule;
-    cv::Mat prevFrame;
-    QTime featureCheckTimer;
+    FrameFlip flip;
+    cv::Size frameSize;
+    Point lastFeaturePosition;
+    DetectionScheduler detectionScheduler;
+    QMutex clickMutex;
+    Point pendingClick;
+    QMutex trackingModuleMutex;
+    ITrackingModule *pendingTrackingModule;
+
+    void applyPendingClick(cv::Mat &frame, qint64 captureTime);
+    void applyPendingTrackingModule(cv::Mat &frame, qint64 captureTime);
 };
 
 } // namespace CMS
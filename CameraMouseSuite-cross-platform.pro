@@ -16,85 +16,14 @@
 #  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #-------------------------------------------------
 
-QT       += core gui multimedia multimediawidgets
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+# CameraMouseSuite: the application
+app.file = CameraMouseSuite.pro
+app.makefile = Makefile.CameraMouseSuite
 
-TARGET = CameraMouseSuite
-TEMPLATE = app
+# ReplayBenchmark: feeds recorded video through the tracking pipeline without a camera or GUI
+benchmark.file = benchmark/ReplayBenchmark.pro
 
-unix {
-    QT_CONFIG -= no-pkg-config
-    CONFIG += c++11 link_pkgconfig
-    LIBS += -L/usr/local/lib
-
-    mac {
-      PKG_CONFIG = /usr/local/bin/pkg-config
-    }
-
-    linux {
-        PKGCONFIG += x11
-    }
-
-    PKGCONFIG += opencv
-}
-
-mac {
-    LIBS += -framework ApplicationServices \
-            -framework AppKit \
-            -framework Foundation
-
-    OBJECTIVE_SOURCES += MacKeyboard.mm
-}
-
-win32 {
-    INCLUDEPATH += $$(OPENCV_INCLUDE) \
-                   $$(OPENCV_INCLUDE)/opencv
-    CONFIG(debug, debug|release) {
-        LIBS += $$(OPENCV_DIR)/lib/*d.lib
-        message(Debug configuration!)
-    }
-    CONFIG(release, debug|release) {
-        LIBS += -L$$(OPENCV_DIR)/lib/ \
-                -lopencv_core2411 \
-                -lopencv_imgproc2411 \
-                -lopencv_objdetect2411 \
-                -lopencv_video2411
-        message(Release configuration!)
-    }
-}
-
-SOURCES += *.cpp
-
-HEADERS  += *.h
-
-FORMS    += mainWindow.ui
-
-OTHER_FILES += \
-    README.md \
-    cascades/*.xml
-
-RESOURCES += \
-    icons.qrc
-
-# Copy haar cascade files
-SRC = $${PWD}/cascades
-DEST = $${OUT_PWD}/cascades
-
-win32 {
-CONFIG(debug, debug|release) DEST = $${OUT_PWD}/debug/cascades
-CONFIG(release, debug|release) DEST = $${OUT_PWD}/release/cascades
-
-SRC ~= s,/,\\,g
-DEST ~= s,/,\\,g
-}
-
-mac {
-DEST = $${OUT_PWD}/CameraMouseSuite.app/Contents/MacOS
-}
-
-copydata.commands = $(COPY_DIR) $$SRC $$DEST
-first.depends = $(first) copydata
-export(first.depends)
-export(copydata.commands)
-QMAKE_EXTRA_TARGETS += first copydata
+SUBDIRS += app \
+           benchmark
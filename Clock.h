@@ -0,0 +1,35 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_CLOCK_H
+#define CMS_CLOCK_H
+
+#include <QtGlobal>
+
+namespace CMS {
+
+// Monotonic time that can be compared across threads
+class Clock
+{
+public:
+    static qint64 nowMicros();
+    static qint64 nowNanos();
+};
+
+} // namespace CMS
+
+#endif // CMS_CLOCK_H
@@ -0,0 +1,87 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <limits>
+
+#include "DetectionScheduler.h"
+
+namespace CMS {
+
+const double DetectionScheduler::LOW_CONFIDENCE = 0.5;
+
+DetectionScheduler::DetectionScheduler() :
+    lastAttempt(std::numeric_limits<qint64>::min() / 2),
+    lastDetection(std::numeric_limits<qint64>::min() / 2),
+    lowConfidenceFrames(0),
+    detectionCount(0),
+    detectionPending(false)
+{
+}
+
+void DetectionScheduler::restart(qint64 time)
+{
+    lastAttempt = time;
+    lastDetection = time;
+    lowConfidenceFrames = 0;
+    detectionPending = false;
+}
+
+bool DetectionScheduler::shouldDetect(const TrackResult &result, qint64 time)
+{
+    if (result.lost || result.confidence < LOW_CONFIDENCE)
+        lowConfidenceFrames++;
+    else
+        lowConfidenceFrames = 0;
+
+    // A detection that found nothing is not repeated on every frame
+    if (detectionPending || time - lastAttempt < RETRY_INTERVAL)
+        return false;
+    if (result.lost || lowConfidenceFrames >= LOW_CONFIDENCE_FRAMES)
+        return true;
+    return time - lastDetection >= DRIFT_CHECK_INTERVAL;
+}
+
+void DetectionScheduler::detectionStarted()
+{
+    detectionPending = true;
+}
+
+void DetectionScheduler::detectionDone(bool found, qint64 time)
+{
+    detectionCount++;
+    detectionPending = false;
+    lastAttempt = time;
+    if (found)
+    {
+        lastDetection = time;
+        lowConfidenceFrames = 0;
+    }
+}
+
+// Whether the tracker has not been unsure long enough to ask for a detection
+bool DetectionScheduler::isConfident()
+{
+    return lowConfidenceFrames < LOW_CONFIDENCE_FRAMES;
+}
+
+int DetectionScheduler::getDetectionCount()
+{
+    return detectionCount;
+}
+
+} // namespace CMS
@@ -0,0 +1,58 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CMS_DETECTIONSCHEDULER_H
+#define CMS_DETECTIONSCHEDULER_H
+
+#include <QtGlobal>
+
+#include "TrackingModule.h"
+
+namespace CMS {
+
+// Decides when the feature detection is run again while tracking. It runs as
+// soon as the tracker loses the feature or stays unsure of it for a few
+// frames, and otherwise only now and then to catch drift the tracker can not
+// notice itself. Times are in microseconds, as given by Clock::nowMicros().
+class DetectionScheduler
+{
+public:
+    DetectionScheduler();
+    void restart(qint64 time); // The track point was just set
+    bool shouldDetect(const TrackResult &result, qint64 time);
+    void detectionStarted(); // Nothing more is asked for until it is done
+    void detectionDone(bool found, qint64 time);
+    bool isConfident();
+    int getDetectionCount();
+
+private:
+    static const double LOW_CONFIDENCE;
+    static const int LOW_CONFIDENCE_FRAMES = 3;
+    static const qint64 RETRY_INTERVAL = 500000;
+    static const qint64 DRIFT_CHECK_INTERVAL = 5000000;
+
+    qint64 lastAttempt;
+    qint64 lastDetection;
+    int lowConfidenceFrames;
+    int detectionCount;
+    bool detectionPending;
+};
+
+} // namespace CMS
+
+#endif // CMS_DETECTIONSCHEDULER_H
@@ -0,0 +1,169 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FeatureDetectionWorker.h"
+
+namespace CMS {
+
+FeatureDetectionWorker::FeatureDetectionWorker() :
+    poolAllocations(0),
+    poolDetectionsWithAllocations(0),
+    snapshotGeneration(0),
+    generation(0),
+    hasSnapshot(false),
+    resultReady(false),
+    synchronous(false),
+    localFaceSearch(true),
+    equalizeFaces(false),
+    running(true)
+{
+    initializationModule.setBufferPool(&bufferPool);
+}
+
+FeatureDetectionWorker::~FeatureDetectionWorker()
+{
+    mutex.lock();
+    running = false;
+    snapshotAvailable.wakeOne();
+    mutex.unlock();
+    wait();
+}
+
+bool FeatureDetectionWorker::allFilesLoaded()
+{
+    return initializationModule.allFilesLoaded();
+}
+
+void FeatureDetectionWorker::setFrameFlip(FrameFlip flip)
+{
+    QMutexLocker locker(&mutex);
+    this->flip = flip;
+}
+
+void FeatureDetectionWorker::setSynchronous(bool synchronous)
+{
+    QMutexLocker locker(&mutex);
+    this->synchronous = synchronous;
+}
+
+void FeatureDetectionWorker::setLocalFaceSearch(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    localFaceSearch = enabled;
+}
+
+void FeatureDetectionWorker::setHistogramEqualization(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    equalizeFaces = enabled;
+}
+
+// The thread is only started by the first asynchronous detection
+bool FeatureDetectionWorker::post(const cv::Mat &frame, Point trackPoint)
+{
+    QMutexLocker locker(&mutex);
+    if (hasSnapshot)
+        return false;
+    // The snapshot keeps its buffer from one detection to the next
+    frame.copyTo(snapshot);
+    snapshotTrackPoint = trackPoint;
+    snapshotGeneration = generation;
+    if (synchronous)
+    {
+        result = detect(snapshot, trackPoint);
+        resultTrackPoint = trackPoint;
+        resultReady = true;
+        return true;
+    }
+    hasSnapshot = true;
+    if (!isRunning())
+        start(QThread::LowPriority);
+    snapshotAvailable.wakeOne();
+    return true;
+}
+
+bool FeatureDetectionWorker::takeResult(Point &position, Point &trackPoint)
+{
+    QMutexLocker locker(&mutex);
+    if (!resultReady)
+        return false;
+    position = result;
+    trackPoint = resultTrackPoint;
+    resultReady = false;
+    return true;
+}
+
+void FeatureDetectionWorker::discardResults()
+{
+    QMutexLocker locker(&mutex);
+    generation++;
+    resultReady = false;
+}
+
+void FeatureDetectionWorker::getPoolAllocations(int &allocations, int &detectionsWithAllocations)
+{
+    QMutexLocker locker(&mutex);
+    allocations = poolAllocations;
+    detectionsWithAllocations = poolDetectionsWithAllocations;
+}
+
+// Called with the mutex locked
+Point FeatureDetectionWorker::detect(cv::Mat &frame, Point trackPoint)
+{
+    initializationModule.setFrameFlip(flip);
+    initializationModule.setLocalFaceSearch(localFaceSearch);
+    initializationModule.setHistogramEqualization(equalizeFaces);
+    bufferPool.beginFrame();
+    Point position = initializationModule.initializeFeature(frame, trackPoint);
+    poolAllocations = bufferPool.getAllocations();
+    poolDetectionsWithAllocations = bufferPool.getFramesWithAllocations();
+    return position;
+}
+
+// The snapshot is only written by post() while there is none, so the
+// detection can run on it without holding the mutex
+void FeatureDetectionWorker::run()
+{
+    QMutexLocker locker(&mutex);
+    while (running)
+    {
+        if (!hasSnapshot)
+        {
+            snapshotAvailable.wait(&mutex);
+            continue;
+        }
+        initializationModule.setFrameFlip(flip);
+        initializationModule.setLocalFaceSearch(localFaceSearch);
+        initializationModule.setHistogramEqualization(equalizeFaces);
+        bufferPool.beginFrame();
+        locker.unlock();
+        Point position = initializationModule.initializeFeature(snapshot, snapshotTrackPoint);
+        locker.relock();
+        poolAllocations = bufferPool.getAllocations();
+        poolDetectionsWithAllocations = bufferPool.getFramesWithAllocations();
+        if (snapshotGeneration == generation)
+        {
+            result = position;
+            resultTrackPoint = snapshotTrackPoint;
+            resultReady = true;
+        }
+        hasSnapshot = false;
+    }
+}
+
+} // namespace CMS
@@ -0,0 +1,91 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CMS_FEATUREDETECTIONWORKER_H
+#define CMS_FEATUREDETECTIONWORKER_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <cv.h>
+
+#include "FeatureInitializationModule.h"
+#include "FrameFlip.h"
+#include "Point.h"
+
+namespace CMS {
+
+// Runs the feature detection on its own thread, on a copy of the frame, so
+// that tracking carries on while the cascades run. One detection runs at a
+// time: frames posted while it is busy are refused. In synchronous mode the
+// detection runs in post() instead, which makes replays reproducible.
+class FeatureDetectionWorker : public QThread
+{
+public:
+    FeatureDetectionWorker();
+    ~FeatureDetectionWorker();
+    bool allFilesLoaded();
+    void setFrameFlip(FrameFlip flip);
+    void setSynchronous(bool synchronous);
+    void setLocalFaceSearch(bool enabled);
+    void setHistogramEqualization(bool enabled);
+    // Whether the frame was taken. trackPoint is where the feature is
+    // tracked in it, if anywhere
+    bool post(const cv::Mat &frame, Point trackPoint = Point());
+    // Once per finished detection, position is empty if nothing was found.
+    // trackPoint is the one posted with the frame the detection ran on
+    bool takeResult(Point &position, Point &trackPoint);
+    // Drops the results of the frames posted so far, including one still
+    // being detected on, e.g. once the user picked the feature
+    void discardResults();
+    // Allocations of the detection's own buffer pool, and in how many
+    // detections they happened
+    void getPoolAllocations(int &allocations, int &detectionsWithAllocations);
+
+protected:
+    void run();
+
+private:
+    FeatureInitializationModule initializationModule;
+    // Only used by the detection, whichever thread runs it; its counters
+    // are copied under the mutex after each detection
+    FrameBufferPool bufferPool;
+    int poolAllocations;
+    int poolDetectionsWithAllocations;
+    QMutex mutex;
+    QWaitCondition snapshotAvailable;
+    cv::Mat snapshot;
+    Point snapshotTrackPoint;
+    unsigned snapshotGeneration;
+    unsigned generation; // Bumped by discardResults()
+    bool hasSnapshot;
+    bool resultReady;
+    Point result;
+    Point resultTrackPoint;
+    FrameFlip flip;
+    bool synchronous;
+    bool localFaceSearch;
+    bool equalizeFaces;
+    bool running;
+
+    Point detect(cv::Mat &frame, Point trackPoint);
+};
+
+} // namespace CMS
+
+#endif // CMS_FEATUREDETECTIONWORKER_H
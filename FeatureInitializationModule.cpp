@@ -19,14 +19,112 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <set>
+#include <stdexcept>
 #include <QDebug>
+#include <QRunnable>
+#include <QThread>
 
 #include "FeatureInitializationModule.h"
+#include "Profiler.h"
 
 namespace CMS {
 
-FeatureInitializationModule::FeatureInitializationModule()
+namespace {
+
+// Where a facial feature can be, as fractions of the face box. The
+// regions overlap so a feature on a border is still fully inside one
+struct FeatureRegion
+{
+    double left, top, right, bottom;
+    // Smallest and largest feature, as fractions of the face height
+    double minSize, maxSize;
+};
+
+// The right eye cascade finds the eye on the left of the image (see
+// applyGeometricConstraints) and the left eye cascade the one on the right
+const FeatureRegion RIGHT_EYE_REGION = { 0, 0.1, 0.6, 0.6, 0.1, 0.4 };
+const FeatureRegion LEFT_EYE_REGION = { 0.4, 0.1, 1, 0.6, 0.1, 0.4 };
+const FeatureRegion NOSE_REGION = { 0.15, 0.25, 0.85, 0.8, 0.15, 0.5 };
+const FeatureRegion MOUTH_REGION = { 0.1, 0.6, 0.9, 1, 0.15, 0.6 };
+
+void toGrey(const cv::Mat &src, cv::Mat &dst)
+{
+    if (src.channels() == 1)
+        src.copyTo(dst);
+    else
+        cv::cvtColor(src, dst, src.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+}
+
+// One detectMultiScale call restricted to a region of the face, run by
+// the cascade thread pool. Found objects are in face coordinates
+class CascadeTask : public QRunnable
+{
+public:
+    CascadeTask(cv::CascadeClassifier &cascade, const cv::Mat &face, const FeatureRegion &region,
+                std::vector<cv::Rect> &objects) :
+        cascade(cascade), objects(objects)
+    {
+        setAutoDelete(false);
+        cv::Size size = face.size();
+        cv::Point topLeft((int)(region.left*size.width), (int)(region.top*size.height));
+        cv::Point bottomRight((int)(region.right*size.width), (int)(region.bottom*size.height));
+        roi = cv::Rect(topLeft, bottomRight);
+        image = face(roi);
+        // The sizes follow the face, so small faces still fit their features
+        // in the regions
+        int regionSide = std::min(roi.width, roi.height);
+        int minSizeH = std::min<int>(regionSide, (int)(region.minSize*size.height));
+        int maxSizeH = std::min<int>(regionSide, std::max<int>(minSizeH, (int)(region.maxSize*size.height)));
+        minSize = cv::Size(minSizeH, minSizeH);
+        maxSize = cv::Size(maxSizeH, maxSizeH);
+    }
+
+    void run()
+    {
+        try
+        {
+            objects.clear();
+            cascade.detectMultiScale(image, objects, 1.2, 2, 0, minSize, maxSize);
+            for (std::vector<cv::Rect>::iterator it = objects.begin(); it != objects.end(); it++)
+            {
+                it->x += roi.x;
+                it->y += roi.y;
+            }
+        }
+        catch (std::exception &e)
+        {
+            error = e.what();
+        }
+    }
+
+    std::string error; // Exceptions can not leave the pool thread, they are rethrown by the caller
+
+private:
+    cv::CascadeClassifier &cascade;
+    cv::Rect roi;
+    cv::Mat image;
+    cv::Size minSize;
+    cv::Size maxSize;
+    std::vector<cv::Rect> &objects;
+};
+
+}
+
+// The local face search covers the face box moved with the tracked
+// feature, grown by FACE_ROI_PADDING of its size on each side, for faces
+// between FACE_ROI_MIN_SCALE and FACE_ROI_MAX_SCALE of its size
+const double FeatureInitializationModule::FACE_ROI_PADDING = 0.5;
+const double FeatureInitializationModule::FACE_ROI_MIN_SCALE = 0.8;
+const double FeatureInitializationModule::FACE_ROI_MAX_SCALE = 1.25;
+
+FeatureInitializationModule::FeatureInitializationModule() :
+    bufferPool(&ownBufferPool),
+    equalizeFaces(false),
+    localFaceSearch(true),
+    faceRoiMisses(0)
 {
+    cascadePool.setMaxThreadCount(std::min(4, std::max(1, QThread::idealThreadCount())));
+
     filesLoaded = true;
 
     QDir dir;
@@ -47,6 +145,44 @@ bool FeatureInitializationModule::allFilesLoaded()
     return filesLoaded;
 }
 
+void FeatureInitializationModule::setFrameFlip(FrameFlip flip)
+{
+    this->flip = flip;
+}
+
+void FeatureInitializationModule::setBufferPool(FrameBufferPool *bufferPool)
+{
+    this->bufferPool = bufferPool;
+}
+
+void FeatureInitializationModule::setHistogramEqualization(bool enabled)
+{
+    equalizeFaces = enabled;
+}
+
+void FeatureInitializationModule::setLocalFaceSearch(bool enabled)
+{
+    if (enabled == localFaceSearch)
+        return;
+    localFaceSearch = enabled;
+    lastFace = cv::Rect();
+    faceRoiMisses = 0;
+}
+
+// Where the face should be now, in frame coordinates, or an empty
+// rectangle if the whole frame has to be scanned
+cv::Rect FeatureInitializationModule::localFaceRegion(cv::Size frameSize, Point trackPoint)
+{
+    if (!localFaceSearch || trackPoint.empty() || lastFace.area() == 0 || faceRoiMisses >= MAX_FACE_ROI_MISSES)
+        return cv::Rect();
+    Point shift = trackPoint - lastNose;
+    int padX = (int)(FACE_ROI_PADDING * lastFace.width);
+    int padY = (int)(FACE_ROI_PADDING * lastFace.height);
+    cv::Rect region(lastFace.x + (int)shift.X() - padX, lastFace.y + (int)shift.Y() - padY,
+                    lastFace.width + 2 * padX, lastFace.height + 2 * padY);
+    return region & cv::Rect(cv::Point(0, 0), frameSize);
+}
+
 // **** Rectangle comparators ****
 // Use an unnamed namespace to restrict global variables scope
 namespace {
@@ -66,8 +202,55 @@ bool compareRectByHeight(cv::Rect r1, cv::Rect r2)
     return r1.height < r2.height;
 }
 
-Point FeatureInitializationModule::initializeFeature(cv::Mat &frame)
+// Faces in the flipped and downscaled frame, searched for in region (in
+// frame coordinates) if it is not empty
+void FeatureInitializationModule::detectFaces(cv::Mat &frame, cv::Rect region, std::vector<cv::Rect> &faces)
+{
+    ScopedStageTimer timer(STAGE_FACE_SEARCH);
+
+    // Minimum face size to detect
+    int minFaceH = std::max<int>(50, (int)(0.075*frame.size().height));
+    cv::Size minFace(minFaceH, minFaceH);
+
+    cv::Size pyrDownSize((frame.size().width + 1) / 2, (frame.size().height + 1) / 2);
+    cv::Mat &pyrDownFrame = bufferPool->get(BUFFER_PYR_DOWN, pyrDownSize, frame.type());
+    cv::Mat &pyrDownGrey = bufferPool->get(BUFFER_PYR_DOWN_GREY, pyrDownSize, CV_8UC1);
+    cv::pyrDown(frame, pyrDownFrame, pyrDownSize);
+    toGrey(pyrDownFrame, pyrDownGrey);
+    // The cascades expect the image as the user sees it, frames are only
+    // flipped here (after downscaling) instead of when they are captured
+    if (!flip.isIdentity())
+        cv::flip(pyrDownGrey, pyrDownGrey, flip.cvFlipCode());
+    if (region.area() > 0)
+    {
+        // Only near the last face, at about its size (all halved as the frame)
+        cv::Rect flippedRegion = flip.apply(region, frame.size());
+        cv::Rect pyrDownRegion = cv::Rect(flippedRegion.x / 2, flippedRegion.y / 2,
+                                          flippedRegion.width / 2, flippedRegion.height / 2)
+                & cv::Rect(cv::Point(0, 0), pyrDownSize);
+        int minFaceROIH = std::max<int>(minFaceH, (int)(FACE_ROI_MIN_SCALE * lastFace.height / 2));
+        int maxFaceROIH = std::max<int>(minFaceROIH, (int)(FACE_ROI_MAX_SCALE * lastFace.height / 2));
+        if (pyrDownRegion.width >= minFaceROIH && pyrDownRegion.height >= minFaceROIH)
+        {
+            faceCascade.detectMultiScale(pyrDownGrey(pyrDownRegion), faces, 1.2, 2, 0,
+                                         cv::Size(minFaceROIH, minFaceROIH), cv::Size(maxFaceROIH, maxFaceROIH));
+            for (std::vector<cv::Rect>::iterator it = faces.begin(); it != faces.end(); it++)
+            {
+                it->x += pyrDownRegion.x;
+                it->y += pyrDownRegion.y;
+            }
+        }
+    }
+    else
+    {
+        faceCascade.detectMultiScale(pyrDownGrey, faces, 1.2, 2, 0, minFace);
+    }
+}
+
+Point FeatureInitializationModule::initializeFeature(cv::Mat &frame, Point trackPoint)
 {
+    ScopedStageTimer timer(STAGE_DETECTION);
+
     if (!filesLoaded)
     {
         return Point();
@@ -75,23 +258,27 @@ Point FeatureInitializationModule::initializeFeature(cv::Mat &frame)
 
     center = Point(frame.size().width / 2.0, frame.size().height / 2.0);
 
-    // Minimum face size to detect
-    int minFaceH = std::max<int>(50, (int)(0.075*frame.size().height));
-    cv::Size minFace(minFaceH, minFaceH);
-
     std::vector<cv::Rect> candidateNoses;
+    std::vector<cv::Rect> candidateFaces;
     std::vector<cv::Rect> faces;
-    cv::Mat pyrDownFrame;
-    cv::pyrDown(frame, pyrDownFrame);
-    faceCascade.detectMultiScale(pyrDownFrame, faces, 1.2, 2, 0, minFace);
+    cv::Rect region = localFaceRegion(frame.size(), trackPoint);
+    detectFaces(frame, region, faces);
+
+    ScopedStageTimer featuresTimer(STAGE_FACE_FEATURES);
     for (std::vector<cv::Rect>::iterator it = faces.begin(); it != faces.end(); it++)
     {
-        cv::Mat face;
         it->x *= 2;
         it->y *= 2;
         it->width *= 2;
         it->height *= 2;
-        face = frame(*it);
+        // Each face is prepared once at full resolution and shared by all
+        // the feature cascades, which then skip their own grey conversion
+        cv::Mat &face = bufferPool->get(BUFFER_FACE, it->size(), CV_8UC1);
+        toGrey(frame(flip.apply(*it, frame.size())), face);
+        if (!flip.isIdentity())
+            cv::flip(face, face, flip.cvFlipCode());
+        if (equalizeFaces)
+            cv::equalizeHist(face, face);
 
         cv::Rect nose = detectNose(face);
         if (nose.width > 0 && nose.height > 0) // Found nose!
@@ -99,27 +286,51 @@ Point FeatureInitializationModule::initializeFeature(cv::Mat &frame)
             nose.x += it->x;
             nose.y += it->y;
             candidateNoses.push_back(nose);
+            candidateFaces.push_back(*it);
         }
     }
-    if (candidateNoses.size() == 0) return Point();
-    cv::Rect detectedNose = *std::max_element(candidateNoses.begin(), candidateNoses.end(), compareRectByProximityToCenter);
-    return Point(detectedNose.x + detectedNose.width / 2, detectedNose.y + detectedNose.height / 2);
+    if (candidateNoses.size() == 0)
+    {
+        // The local search is retried a few times before scanning the whole frame again
+        if (region.area() > 0)
+        {
+            faceRoiMisses++;
+        }
+        else
+        {
+            lastFace = cv::Rect();
+            faceRoiMisses = 0;
+        }
+        return Point();
+    }
+    size_t detected = std::max_element(candidateNoses.begin(), candidateNoses.end(), compareRectByProximityToCenter) - candidateNoses.begin();
+    cv::Rect detectedNose = candidateNoses[detected];
+    Point nosePosition = flip.apply(Point(detectedNose.x + detectedNose.width / 2, detectedNose.y + detectedNose.height / 2), frame.size());
+    lastFace = flip.apply(candidateFaces[detected], frame.size());
+    lastNose = nosePosition;
+    faceRoiMisses = 0;
+    return nosePosition;
 }
 
 cv::Rect FeatureInitializationModule::detectNose(cv::Mat &face)
 {
-    // Minimum face feature size to detect
-    int minFaceFeatureH = std::max<int>(50, (int)(0.075*face.size().height));
-    cv::Size minFaceFeature(minFaceFeatureH, minFaceFeatureH);
-
     std::vector<cv::Rect> leftEyes;
     std::vector<cv::Rect> rightEyes;
     std::vector<cv::Rect> noses;
     std::vector<cv::Rect> mouths;
-    leftEyeCascade.detectMultiScale(face, leftEyes, 1.2, 2, 0, minFaceFeature);
-    rightEyeCascade.detectMultiScale(face, rightEyes, 1.2, 2, 0, minFaceFeature);
-    noseCascade.detectMultiScale(face, noses, 1.2, 2, 0, minFaceFeature);
-    mouthCascade.detectMultiScale(face, mouths, 1.2, 2, 0, minFaceFeature);
+    CascadeTask leftEyeTask(leftEyeCascade, face, LEFT_EYE_REGION, leftEyes);
+    CascadeTask rightEyeTask(rightEyeCascade, face, RIGHT_EYE_REGION, rightEyes);
+    CascadeTask noseTask(noseCascade, face, NOSE_REGION, noses);
+    CascadeTask mouthTask(mouthCascade, face, MOUTH_REGION, mouths);
+    CascadeTask *tasks[] = {&leftEyeTask, &rightEyeTask, &noseTask, &mouthTask};
+    for (int i = 0; i < 4; i++)
+        cascadePool.start(tasks[i]);
+    cascadePool.waitForDone();
+    for (int i = 0; i < 4; i++)
+    {
+        if (!tasks[i]->error.empty())
+            throw std::runtime_error(tasks[i]->error);
+    }
 
     applyGeometricConstraints(leftEyes, rightEyes, noses, mouths);
 
@@ -19,6 +19,7 @@
 #define CMS_FEATUREINITIALIZATIONMODULE_H
 
 #include <QObject>
+#include <QThreadPool>
 #if defined(Q_OS_LINUX) || defined(Q_OS_WIN32)
 #include <opencv2/opencv.hpp>
 #endif
@@ -26,6 +27,8 @@
 #include <cv.h>
 #include <vector>
 
+#include "FrameBufferPool.h"
+#include "FrameFlip.h"
 #include "Point.h"
 
 namespace CMS {
@@ -35,15 +38,42 @@ class FeatureInitializationModule
 public:
     FeatureInitializationModule();
     bool allFilesLoaded();
-    Point initializeFeature(cv::Mat &frame);
+    // With the tracked position of the feature the face is first searched
+    // for near where it was last found (see setLocalFaceSearch)
+    Point initializeFeature(cv::Mat &frame, Point trackPoint = Point());
+    void setFrameFlip(FrameFlip flip);
+    void setBufferPool(FrameBufferPool *bufferPool);
+    // Enabled by default, otherwise every detection scans the whole frame
+    void setLocalFaceSearch(bool enabled);
+    // Equalizes the faces before their features are searched (disabled by default)
+    void setHistogramEqualization(bool enabled);
 private:
+    static const double FACE_ROI_PADDING;
+    static const double FACE_ROI_MIN_SCALE;
+    static const double FACE_ROI_MAX_SCALE;
+    static const int MAX_FACE_ROI_MISSES = 2;
+
     cv::CascadeClassifier faceCascade;
     cv::CascadeClassifier leftEyeCascade;
     cv::CascadeClassifier rightEyeCascade;
     cv::CascadeClassifier noseCascade;
     cv::CascadeClassifier mouthCascade;
     bool filesLoaded;
+    FrameFlip flip;
+    FrameBufferPool ownBufferPool; // Used until setBufferPool() provides another one
+    FrameBufferPool *bufferPool;
+    // The feature cascades of a face run in parallel, each on its own
+    // classifier (a classifier must not be used by two threads at once)
+    QThreadPool cascadePool;
+    bool equalizeFaces;
+    bool localFaceSearch;
+    cv::Rect lastFace; // In frame coordinates, empty until a nose is found
+    Point lastNose;
+    int faceRoiMisses; // Consecutive local searches that found nothing
+
+    cv::Rect localFaceRegion(cv::Size frameSize, Point trackPoint);
 
+    void detectFaces(cv::Mat &frame, cv::Rect region, std::vector<cv::Rect> &faces);
     cv::Rect detectNose(cv::Mat &face);
     void applyGeometricConstraints(std::vector<cv::Rect> &leftEyes,
                                    std::vector<cv::Rect> &rightEyes,
@@ -0,0 +1,85 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FrameBufferPool.h"
+
+namespace CMS {
+
+FrameBufferPool::FrameBufferPool() :
+    allocations(0),
+    frameAllocations(0),
+    framesWithAllocations(0)
+{
+}
+
+cv::Mat &FrameBufferPool::get(PoolBuffer id, cv::Size size, int type)
+{
+    cv::Mat &buffer = buffers[id];
+    uchar *data = buffer.data;
+    buffer.create(size, type);
+    if (buffer.data != data)
+        countAllocation();
+    return buffer;
+}
+
+QImage &FrameBufferPool::getImage(PoolImage id, QSize size, QImage::Format format)
+{
+    QImage &image = images[id];
+    if (image.size() != size || image.format() != format)
+    {
+        image = QImage(size, format);
+        countAllocation();
+    }
+    else
+    {
+        // If a copy handed out earlier is still in use, writing to the image detaches it
+        const uchar *data = image.constBits();
+        if (image.bits() != data)
+            countAllocation();
+    }
+    return image;
+}
+
+void FrameBufferPool::beginFrame()
+{
+    frameAllocations = 0;
+}
+
+int FrameBufferPool::getAllocations()
+{
+    return allocations;
+}
+
+int FrameBufferPool::getFrameAllocations()
+{
+    return frameAllocations;
+}
+
+int FrameBufferPool::getFramesWithAllocations()
+{
+    return framesWithAllocations;
+}
+
+void FrameBufferPool::countAllocation()
+{
+    if (frameAllocations == 0)
+        framesWithAllocations++;
+    allocations++;
+    frameAllocations++;
+}
+
+} // namespace CMS
@@ -0,0 +1,86 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_FRAMEBUFFERPOOL_H
+#define CMS_FRAMEBUFFERPOOL_H
+
+#include <QImage>
+#include <QSize>
+#include <cv.h>
+
+namespace CMS {
+
+// Buffers reused from frame to frame by the stages of the pipeline
+enum PoolBuffer
+{
+    BUFFER_LUMA,
+    BUFFER_BGR,
+    BUFFER_PREVIEW_SMALL,
+    BUFFER_LK_GREY,
+    BUFFER_WORKING_FRAME,
+    BUFFER_WORKING_GREY,
+    BUFFER_FULL_SEARCH_GREY,
+    BUFFER_MATCH_RESULT,
+    BUFFER_FULL_MATCH_RESULT,
+    BUFFER_SCALE_SEARCH,
+    BUFFER_SCALE_MATCH_RESULT,
+    BUFFER_PYR_DOWN,
+    BUFFER_PYR_DOWN_GREY,
+    BUFFER_FACE,
+    BUFFER_CORRELATION_GREY,
+    BUFFER_CORRELATION_PADDED,
+    BUFFER_COUNT
+};
+
+enum PoolImage
+{
+    IMAGE_PREVIEW,
+    IMAGE_COUNT
+};
+
+// Per-frame temporaries are taken from here instead of being allocated for
+// every frame. A buffer is only reallocated when the requested size or type
+// changes, so once the first frames went through there should be no
+// allocations left, which the counters make easy to check.
+// Buffers are overwritten on the next frame: anything kept longer must be copied.
+class FrameBufferPool
+{
+public:
+    FrameBufferPool();
+    cv::Mat &get(PoolBuffer id, cv::Size size, int type);
+    QImage &getImage(PoolImage id, QSize size, QImage::Format format);
+    void beginFrame();
+    int getAllocations();
+    int getFrameAllocations(); // Since beginFrame()
+    int getFramesWithAllocations();
+
+private:
+    cv::Mat buffers[BUFFER_COUNT];
+    QImage images[IMAGE_COUNT];
+    int allocations;
+    int frameAllocations;
+    int framesWithAllocations;
+
+    void countAllocation();
+
+    FrameBufferPool(const FrameBufferPool&);
+    FrameBufferPool& operator=(const FrameBufferPool&);
+};
+
+} // namespace CMS
+
+#endif // CMS_FRAMEBUFFERPOOL_H
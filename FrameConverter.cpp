@@ -0,0 +1,157 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#if defined(Q_OS_LINUX) || defined(Q_OS_WIN32)
+#include <opencv2/imgproc.hpp>
+#endif
+#include <stdexcept>
+
+#include "FrameConverter.h"
+
+namespace CMS {
+
+QList<QVideoFrame::PixelFormat> FrameConverter::supportedFormats()
+{
+    // Formats most webcams deliver natively come first, so Qt does not have to convert them
+    return QList<QVideoFrame::PixelFormat>() << QVideoFrame::Format_YUYV
+                                             << QVideoFrame::Format_NV12
+                                             << QVideoFrame::Format_YUV420P
+                                             << QVideoFrame::Format_RGB24
+                                             << QVideoFrame::Format_RGB32;
+}
+
+cv::Mat FrameConverter::wrap(QVideoFrame &mappedFrame, FrameBufferPool &bufferPool)
+{
+    uchar *bits = mappedFrame.bits();
+    size_t step = mappedFrame.bytesPerLine();
+    switch (mappedFrame.pixelFormat())
+    {
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_YUV420P:
+        // The Y plane comes first and is used as it is
+        return cv::Mat(mappedFrame.height(), mappedFrame.width(), CV_8UC1, bits, step);
+    case QVideoFrame::Format_YUYV:
+    {
+        // Y0 U Y1 V: luma is every other byte
+        cv::Mat yuyv(mappedFrame.height(), mappedFrame.width(), CV_8UC2, bits, step);
+        cv::Mat &luma = bufferPool.get(BUFFER_LUMA, yuyv.size(), CV_8UC1);
+        cv::extractChannel(yuyv, luma, 0);
+        return luma;
+    }
+    case QVideoFrame::Format_RGB32:
+        // Same memory layout as BGRA
+        return cv::Mat(mappedFrame.height(), mappedFrame.width(), CV_8UC4, bits, step);
+    case QVideoFrame::Format_RGB24:
+    {
+        // The grey conversions and the cascades expect BGR, swapping once
+        // here keeps the red and blue weights right for all of them
+        cv::Mat rgb(mappedFrame.height(), mappedFrame.width(), CV_8UC3, bits, step);
+        cv::Mat &bgr = bufferPool.get(BUFFER_BGR, rgb.size(), CV_8UC3);
+        cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+        return bgr;
+    }
+    default:
+        throw std::invalid_argument("Pixel format not supported");
+    }
+}
+
+QSize FrameConverter::previewSize(cv::Mat &frame, QSize availableSize)
+{
+    QSize size = QSize(frame.cols, frame.rows).scaled(availableSize, Qt::KeepAspectRatio);
+    // Subsampled chroma needs even dimensions
+    return QSize(size.width() & ~1, size.height() & ~1);
+}
+
+void FrameConverter::preview(QVideoFrame &mappedFrame, cv::Mat &frame, cv::Mat &previewMat, FrameFlip flip, FrameBufferPool &bufferPool)
+{
+    // Only the downscaled image is converted and flipped
+    switch (mappedFrame.pixelFormat())
+    {
+    case QVideoFrame::Format_RGB32:
+        cv::resize(frame, previewMat, previewMat.size(), 0, 0, cv::INTER_AREA);
+        break;
+    case QVideoFrame::Format_RGB24:
+    {
+        cv::Mat &small = bufferPool.get(BUFFER_PREVIEW_SMALL, previewMat.size(), frame.type());
+        cv::resize(frame, small, previewMat.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, previewMat, cv::COLOR_BGR2BGRA);
+        break;
+    }
+    case QVideoFrame::Format_YUYV:
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_YUV420P:
+        yuvPreview(mappedFrame, frame, previewMat, bufferPool);
+        break;
+    default:
+        throw std::invalid_argument("Pixel format not supported");
+    }
+    if (!flip.isIdentity())
+        cv::flip(previewMat, previewMat, flip.cvFlipCode());
+}
+
+// Downscales each plane first and converts only the small image to colour
+void FrameConverter::yuvPreview(QVideoFrame &mappedFrame, cv::Mat &frame, cv::Mat &previewMat, FrameBufferPool &bufferPool)
+{
+    int width = previewMat.cols;
+    int height = previewMat.rows;
+    int frameWidth = mappedFrame.width();
+    int frameHeight = mappedFrame.height();
+
+    switch (mappedFrame.pixelFormat())
+    {
+    case QVideoFrame::Format_YUYV:
+    {
+        // Each Y0 U Y1 V macropixel is resized as one 4 channel pixel
+        cv::Mat macropixels(frameHeight, frameWidth / 2, CV_8UC4, mappedFrame.bits(), mappedFrame.bytesPerLine());
+        cv::Mat &small = bufferPool.get(BUFFER_PREVIEW_SMALL, cv::Size(width / 2, height), CV_8UC4);
+        cv::resize(macropixels, small, small.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(cv::Mat(height, width, CV_8UC2, small.data, small.step), previewMat, cv::COLOR_YUV2BGRA_YUY2);
+        break;
+    }
+    case QVideoFrame::Format_NV12:
+    {
+        cv::Mat &small = bufferPool.get(BUFFER_PREVIEW_SMALL, cv::Size(width, height * 3 / 2), CV_8UC1);
+        cv::Mat smallY = small.rowRange(0, height);
+        cv::Mat smallUV(height / 2, width / 2, CV_8UC2, small.ptr(height), small.step);
+        cv::Mat uv(frameHeight / 2, frameWidth / 2, CV_8UC2, mappedFrame.bits(1), mappedFrame.bytesPerLine(1));
+        cv::resize(frame, smallY, smallY.size(), 0, 0, cv::INTER_AREA);
+        cv::resize(uv, smallUV, smallUV.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, previewMat, cv::COLOR_YUV2BGRA_NV12);
+        break;
+    }
+    case QVideoFrame::Format_YUV420P:
+    {
+        cv::Mat &small = bufferPool.get(BUFFER_PREVIEW_SMALL, cv::Size(width, height * 3 / 2), CV_8UC1);
+        cv::Mat smallY = small.rowRange(0, height);
+        uchar *smallChroma = small.ptr(height);
+        cv::Mat smallU(height / 2, width / 2, CV_8UC1, smallChroma, width / 2);
+        cv::Mat smallV(height / 2, width / 2, CV_8UC1, smallChroma + (width / 2) * (height / 2), width / 2);
+        cv::Mat u(frameHeight / 2, frameWidth / 2, CV_8UC1, mappedFrame.bits(1), mappedFrame.bytesPerLine(1));
+        cv::Mat v(frameHeight / 2, frameWidth / 2, CV_8UC1, mappedFrame.bits(2), mappedFrame.bytesPerLine(2));
+        cv::resize(frame, smallY, smallY.size(), 0, 0, cv::INTER_AREA);
+        cv::resize(u, smallU, smallU.size(), 0, 0, cv::INTER_AREA);
+        cv::resize(v, smallV, smallV.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, previewMat, cv::COLOR_YUV2BGRA_I420);
+        break;
+    }
+    default:
+        throw std::invalid_argument("Pixel format not supported");
+    }
+}
+
+} // namespace CMS
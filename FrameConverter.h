@@ -0,0 +1,52 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_FRAMECONVERTER_H
+#define CMS_FRAMECONVERTER_H
+
+#include <QImage>
+#include <QList>
+#include <QSize>
+#include <QVideoFrame>
+#include <cv.h>
+
+#include "FrameBufferPool.h"
+#include "FrameFlip.h"
+
+namespace CMS {
+
+// Turns mapped camera frames into what the tracking pipeline and the preview need
+class FrameConverter
+{
+public:
+    static QList<QVideoFrame::PixelFormat> supportedFormats();
+    // Wraps the mapped frame without copying it, the result is only valid until the frame is unmapped.
+    // YUV frames are tracked on their luma only. Packed YUV has to be deinterleaved and RGB24 swapped to BGR,
+    // which is done into a pool buffer.
+    static cv::Mat wrap(QVideoFrame &mappedFrame, FrameBufferPool &bufferPool);
+    // Largest size that fits in availableSize, keeping the aspect ratio of frame
+    static QSize previewSize(cv::Mat &frame, QSize availableSize);
+    // Writes a downscaled (and flipped) colour copy of the frame to be shown to the user into previewMat (BGRA)
+    static void preview(QVideoFrame &mappedFrame, cv::Mat &frame, cv::Mat &previewMat, FrameFlip flip, FrameBufferPool &bufferPool);
+
+private:
+    static void yuvPreview(QVideoFrame &mappedFrame, cv::Mat &frame, cv::Mat &previewMat, FrameBufferPool &bufferPool);
+};
+
+} // namespace CMS
+
+#endif // CMS_FRAMECONVERTER_H
@@ -0,0 +1,78 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject> // Included to have the OS defines
+
+#include "FrameFlip.h"
+
+namespace CMS {
+
+FrameFlip::FrameFlip() :
+    horizontal(false),
+    vertical(false)
+{
+}
+
+FrameFlip::FrameFlip(bool horizontal, bool vertical) :
+    horizontal(horizontal),
+    vertical(vertical)
+{
+}
+
+FrameFlip FrameFlip::cameraMirroring()
+{
+    // The kind of mirroring needed depends on the OS
+#ifdef Q_OS_LINUX
+    return FrameFlip(true, false);
+#elif defined Q_OS_WIN
+    return FrameFlip(true, true);
+#elif defined Q_OS_MAC
+    return FrameFlip(true, false);
+#else
+    return FrameFlip();
+#endif
+}
+
+bool FrameFlip::isIdentity()
+{
+    return !horizontal && !vertical;
+}
+
+int FrameFlip::cvFlipCode()
+{
+    if (horizontal && vertical)
+        return -1;
+    return horizontal ? 1 : 0;
+}
+
+Point FrameFlip::apply(Point point, cv::Size frameSize)
+{
+    if (point.empty())
+        return point;
+    double x = horizontal ? frameSize.width - 1 - point.X() : point.X();
+    double y = vertical ? frameSize.height - 1 - point.Y() : point.Y();
+    return Point(x, y);
+}
+
+cv::Rect FrameFlip::apply(cv::Rect rect, cv::Size frameSize)
+{
+    int x = horizontal ? frameSize.width - rect.x - rect.width : rect.x;
+    int y = vertical ? frameSize.height - rect.y - rect.height : rect.y;
+    return cv::Rect(x, y, rect.width, rect.height);
+}
+
+} // namespace CMS
@@ -0,0 +1,48 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_FRAMEFLIP_H
+#define CMS_FRAMEFLIP_H
+
+#include <cv.h>
+
+#include "Point.h"
+
+namespace CMS {
+
+// Mirroring between the camera image (what the trackers see) and the image
+// shown to the user (what clicks and pointer movement refer to). Flipping is
+// its own inverse, so the same calls convert in both directions.
+class FrameFlip
+{
+public:
+    FrameFlip();
+    FrameFlip(bool horizontal, bool vertical);
+    static FrameFlip cameraMirroring();
+    bool isIdentity();
+    int cvFlipCode(); // As expected by cv::flip, only valid if !isIdentity()
+    Point apply(Point point, cv::Size frameSize);
+    cv::Rect apply(cv::Rect rect, cv::Size frameSize);
+
+private:
+    bool horizontal;
+    bool vertical;
+};
+
+} // namespace CMS
+
+#endif // CMS_FRAMEFLIP_H
@@ -0,0 +1,87 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FrameMailbox.h"
+
+namespace CMS {
+
+CapturedFrame::CapturedFrame(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime) :
+    videoFrame(videoFrame),
+    previewSize(previewSize),
+    captureTime(captureTime)
+{
+}
+
+FrameMailbox::FrameMailbox() :
+    slot(0),
+    spare(0),
+    droppedFrames(0)
+{
+}
+
+FrameMailbox::~FrameMailbox()
+{
+    delete slot.exchange(0);
+    delete spare.exchange(0);
+}
+
+CapturedFrame *FrameMailbox::acquire(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime)
+{
+    CapturedFrame *frame = spare.exchange(0);
+    if (!frame)
+        return new CapturedFrame(videoFrame, previewSize, captureTime);
+    frame->videoFrame = videoFrame;
+    frame->previewSize = previewSize;
+    frame->captureTime = captureTime;
+    return frame;
+}
+
+void FrameMailbox::post(CapturedFrame *frame)
+{
+    CapturedFrame *stale = slot.exchange(frame);
+    if (stale)
+    {
+        droppedFrames++;
+        recycle(stale);
+    }
+}
+
+CapturedFrame *FrameMailbox::take()
+{
+    return slot.exchange(0);
+}
+
+// The camera buffer is released right away. One frame is kept, which is
+// enough as there are at most three in use (posted, processed and being
+// posted).
+void FrameMailbox::recycle(CapturedFrame *frame)
+{
+    frame->videoFrame = QVideoFrame();
+    delete spare.exchange(frame);
+}
+
+bool FrameMailbox::empty()
+{
+    return slot.load() == 0;
+}
+
+int FrameMailbox::getDroppedFrames()
+{
+    return droppedFrames.load();
+}
+
+} // namespace CMS
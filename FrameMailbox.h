@@ -0,0 +1,65 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_FRAMEMAILBOX_H
+#define CMS_FRAMEMAILBOX_H
+
+#include <QSize>
+#include <QVideoFrame>
+#include <atomic>
+
+namespace CMS {
+
+struct CapturedFrame
+{
+    CapturedFrame(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime);
+
+    QVideoFrame videoFrame; // Shallow copy, keeps the camera buffer alive
+    QSize previewSize;
+    qint64 captureTime; // Clock::nowMicros() when the frame was delivered
+};
+
+// Single slot handoff between the thread that delivers camera frames and the
+// tracking thread. Posting never blocks: a frame that was not taken yet is
+// replaced by the newer one and counted as dropped. Frames that were dropped
+// or processed are kept for reuse, so that after the first few frames none
+// are allocated.
+class FrameMailbox
+{
+public:
+    FrameMailbox();
+    ~FrameMailbox();
+    // A recycled frame if there is one, otherwise a new one
+    CapturedFrame *acquire(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime);
+    void post(CapturedFrame *frame); // Takes ownership
+    CapturedFrame *take(); // Caller takes ownership, 0 if empty
+    void recycle(CapturedFrame *frame); // Takes ownership
+    bool empty();
+    int getDroppedFrames();
+
+private:
+    std::atomic<CapturedFrame*> slot;
+    std::atomic<CapturedFrame*> spare;
+    std::atomic<int> droppedFrames;
+
+    FrameMailbox(const FrameMailbox&);
+    FrameMailbox& operator=(const FrameMailbox&);
+};
+
+} // namespace CMS
+
+#endif // CMS_FRAMEMAILBOX_H
@@ -0,0 +1,112 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LatencyHistogram.h"
+
+namespace CMS {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::add(qint64 latencyMicros)
+{
+    if (latencyMicros < 0)
+        latencyMicros = 0;
+    qint64 bucket = latencyMicros / 1000;
+    if (bucket >= BUCKET_COUNT)
+        bucket = BUCKET_COUNT - 1;
+    buckets[bucket]++;
+    count++;
+    totalMicros += latencyMicros;
+    // Only the tracking thread adds values, so this does not race with itself
+    if (latencyMicros > maxMicros.load())
+        maxMicros = latencyMicros;
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKET_COUNT; i++)
+        buckets[i] = 0;
+    count = 0;
+    totalMicros = 0;
+    maxMicros = 0;
+}
+
+int LatencyHistogram::getCount()
+{
+    return count.load();
+}
+
+double LatencyHistogram::getMeanMillis()
+{
+    int n = count.load();
+    if (n == 0)
+        return 0;
+    return totalMicros.load() / 1000.0 / n;
+}
+
+double LatencyHistogram::getMaxMillis()
+{
+    return maxMicros.load() / 1000.0;
+}
+
+double LatencyHistogram::getPercentileMillis(double percentile)
+{
+    int n = count.load();
+    if (n == 0)
+        return 0;
+    double target = percentile / 100.0 * n;
+    int accumulated = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        accumulated += buckets[i].load();
+        if (accumulated >= target)
+            return i + 1;
+    }
+    return BUCKET_COUNT;
+}
+
+QString LatencyHistogram::summary()
+{
+    return QString("%1 samples, mean %2 ms, p50 %3 ms, p90 %4 ms, p99 %5 ms, max %6 ms")
+            .arg(getCount())
+            .arg(getMeanMillis(), 0, 'f', 1)
+            .arg(getPercentileMillis(50))
+            .arg(getPercentileMillis(90))
+            .arg(getPercentileMillis(99))
+            .arg(getMaxMillis(), 0, 'f', 1);
+}
+
+void LatencyHistogram::dump(QTextStream &out)
+{
+    out << summary() << "\n";
+    out << "ms,count\n";
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        int bucketCount = buckets[i].load();
+        if (bucketCount == 0)
+            continue;
+        if (i == BUCKET_COUNT - 1)
+            out << ">=" << i << "," << bucketCount << "\n";
+        else
+            out << i << "-" << i + 1 << "," << bucketCount << "\n";
+    }
+}
+
+} // namespace CMS
@@ -0,0 +1,55 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_LATENCYHISTOGRAM_H
+#define CMS_LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QTextStream>
+#include <atomic>
+
+namespace CMS {
+
+// Histogram of latencies with 1 ms buckets. Values are added by the tracking
+// thread and can be read from any other thread at the same time.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+    void add(qint64 latencyMicros);
+    void reset();
+    int getCount();
+    double getMeanMillis();
+    double getMaxMillis();
+    double getPercentileMillis(double percentile); // Upper bound of the bucket
+    QString summary();
+    void dump(QTextStream &out);
+
+private:
+    static const int BUCKET_COUNT = 500; // The last bucket collects everything above
+    std::atomic<int> buckets[BUCKET_COUNT];
+    std::atomic<int> count;
+    std::atomic<qint64> totalMicros;
+    std::atomic<qint64> maxMicros;
+
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+};
+
+} // namespace CMS
+
+#endif // CMS_LATENCYHISTOGRAM_H
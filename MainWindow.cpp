@@ -16,14 +16,19 @@
  */
 
 #include <QCameraInfo>
+#include <QDebug>
+#include <QFile>
+#include <QFileDialog>
 #include <QMessageBox>
+#include <stdexcept>
 
 #include "MainWindow.h"
 #include "ui_mainWindow.h"
 #include "VideoManagerSurface.h"
 #include "CameraMouseController.h"
-#include "TemplateTrackingModule.h"
+#include "TrackingModuleRegistry.h"
 #include "MouseControlModule.h"
+#include "Profiler.h"
 
 Q_DECLARE_METATYPE(QCameraInfo)
 
@@ -33,6 +38,8 @@ MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     camera(0),
+    controller(0),
+    trackerGroup(0),
     settings(this)
 {
     ui->setupUi(this);
@@ -49,9 +56,9 @@ MainWindow::~MainWindow()
 void MainWindow::setupCameraWidgets()
 {
     // Create video manager
-    ITrackingModule *trackingModule = new TemplateTrackingModule(0.08); // TODO magic constants are not nice :(
+    ITrackingModule *trackingModule = TrackingModuleRegistry::instance().create(settings.getTracker(), settings.getTrackerParameters());
     MouseControlModule *controlModule = new MouseControlModule(settings);
-    CameraMouseController *controller = new CameraMouseController(settings, trackingModule, controlModule);
+    controller = new CameraMouseController(settings, trackingModule, controlModule);
     videoManagerSurface = new VideoManagerSurface(settings, controller, ui->frameLabel, this);
 
     // Create device selection menu
@@ -69,6 +76,21 @@ void MainWindow::setupCameraWidgets()
 
     connect(cameraGroup, SIGNAL(triggered(QAction*)), SLOT(updateSelectedCamera(QAction*)));
 
+    // Create tracker selection menu
+    trackerGroup = new QActionGroup(this);
+    trackerGroup->setExclusive(true);
+    foreach (const QString &tracker, TrackingModuleRegistry::instance().getNames()) {
+        QAction *trackerAction = new QAction(TrackingModuleRegistry::instance().getDescription(tracker), trackerGroup);
+        trackerAction->setCheckable(true);
+        trackerAction->setData(tracker);
+        if (tracker == settings.getTracker())
+            trackerAction->setChecked(true);
+
+        ui->menuTracker->addAction(trackerAction);
+    }
+
+    connect(trackerGroup, SIGNAL(triggered(QAction*)), SLOT(updateSelectedTracker(QAction*)));
+
     setCamera(QCameraInfo::defaultCamera());
     if (!controller->isAutoDetectWorking()) ui->autoDetectNoseCheckBox->setVisible(false);
 }
@@ -114,6 +136,14 @@ void MainWindow::setupSettingsWidgets()
     // Auto Detect Nose
     connect(ui->autoDetectNoseCheckBox, SIGNAL(toggled(bool)), &settings, SLOT(setAutoDetectNose(bool)));
     ui->autoDetectNoseCheckBox->setChecked(settings.isAutoDetectNoseEnabled());
+
+    // Diagnostics
+    connect(ui->actionDumpLatency, SIGNAL(triggered()), this, SLOT(dumpLatency()));
+    connect(ui->actionProfilePipeline, SIGNAL(toggled(bool)), this, SLOT(setProfiling(bool)));
+    connect(ui->actionProfilePipeline, SIGNAL(toggled(bool)), ui->actionSaveProfile, SLOT(setEnabled(bool)));
+    connect(ui->actionSaveProfile, SIGNAL(triggered()), this, SLOT(saveProfile()));
+    ui->actionProfilePipeline->setChecked(Profiler::isEnabled());
+    ui->actionSaveProfile->setEnabled(Profiler::isEnabled());
 }
 
 void MainWindow::updateSelectedCamera(QAction *action)
@@ -142,6 +172,40 @@ void MainWindow::setCamera(const QCameraInfo &cameraInfo)
     camera->searchAndLock();
 }
 
+// Switching trackers while tracking carries on from the current feature position
+QString MainWindow::getTracker()
+{
+    return settings.getTracker();
+}
+
+void MainWindow::selectTracker(const QString &tracker, const QVariantMap &parameters)
+{
+    ITrackingModule *trackingModule = TrackingModuleRegistry::instance().create(tracker, parameters);
+    settings.setTracker(tracker, parameters);
+    controller->setTrackingModule(trackingModule);
+    foreach (QAction *action, trackerGroup->actions())
+        action->setChecked(action->data().toString() == tracker);
+}
+
+void MainWindow::updateSelectedTracker(QAction *action)
+{
+    QString tracker = action->data().toString();
+    // Parameters only carry over to the tracker they were given for
+    QVariantMap parameters;
+    if (tracker == settings.getTracker())
+        parameters = settings.getTrackerParameters();
+    try
+    {
+        selectTracker(tracker, parameters);
+    }
+    catch (std::invalid_argument &e)
+    {
+        QMessageBox::warning(this, tr("Tracker"), QString::fromStdString(e.what()));
+        foreach (QAction *trackerAction, trackerGroup->actions())
+            trackerAction->setChecked(trackerAction->data().toString() == settings.getTracker());
+    }
+}
+
 void MainWindow::updateDwellSpinBox(int dwellMillis)
 {
     double dwellTime = dwellMillis / 1000.0;
@@ -172,4 +236,38 @@ void MainWindow::lockGainClicked(bool lock)
         ui->verticalGainSlider->setValue(ui->horizontalGainSlider->value());
 }
 
+void MainWindow::dumpLatency()
+{
+    LatencyHistogram &histogram = controller->getLatencyHistogram();
+    QString dump;
+    QTextStream out(&dump);
+    histogram.dump(out);
+    qDebug().noquote() << "Latency from frame capture to pointer movement:\n" << dump;
+    int processed = videoManagerSurface->getProcessedFrames();
+    int dropped = videoManagerSurface->getDroppedFrames();
+    qDebug() << "Tracking thread processed" << processed << "frames and dropped" << dropped;
+    ui->statusBar->showMessage(tr("Pointer latency: %1; %2 frames processed, %3 dropped")
+                               .arg(histogram.summary()).arg(processed).arg(dropped));
+}
+
+void MainWindow::setProfiling(bool enabled)
+{
+    Profiler::setEnabled(enabled);
+}
+
+void MainWindow::saveProfile()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Pipeline Profile"), "profile.csv", tr("CSV files (*.csv)"));
+    if (fileName.isEmpty())
+        return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QMessageBox::warning(this, tr("Pipeline profile"), tr("Could not write %1").arg(fileName));
+        return;
+    }
+    QTextStream out(&file);
+    Profiler::instance().writeCsv(out);
+}
+
 } // namespace CMS
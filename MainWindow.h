@@ -19,6 +19,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QActionGroup>
 #include <QCamera>
 #include <QAbstractVideoSurface>
 
@@ -30,6 +31,9 @@ class MainWindow;
 
 namespace CMS {
 
+class CameraMouseController;
+class VideoManagerSurface;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -37,9 +41,13 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
+    QString getTracker();
+    // Throws std::invalid_argument if the tracker can not be created
+    void selectTracker(const QString &tracker, const QVariantMap &parameters = QVariantMap());
 
 private slots:
     void updateSelectedCamera(QAction *action);
+    void updateSelectedTracker(QAction *action);
     void displayCameraError();
     void setCamera(const QCameraInfo &cameraInfo);
     void updateDwellSpinBox(int dwellMillis);
@@ -47,11 +55,16 @@ private slots:
     void horizontalGainChanged(int horizontalGain);
     void verticalGainChanged(int verticalGain);
     void lockGainClicked(bool lock);
+    void dumpLatency();
+    void setProfiling(bool enabled);
+    void saveProfile();
 
 private:
     Ui::MainWindow *ui;
     QCamera *camera;
-    QAbstractVideoSurface *videoManagerSurface;
+    VideoManagerSurface *videoManagerSurface;
+    CameraMouseController *controller;
+    QActionGroup *trackerGroup;
     Settings settings;
 
     void setupCameraWidgets();
@@ -0,0 +1,310 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <QObject>
+#if defined(Q_OS_LINUX) || defined(Q_OS_WIN32)
+#include <opencv2/imgproc.hpp>
+#endif
+
+#include "MosseTrackingModule.h"
+#include "asmOpenCV.h"
+
+namespace CMS {
+
+// Width of the desired response peak, in patch pixels
+const double MosseTrackingModule::OUTPUT_SIGMA = 2;
+// Added to the power spectrum of the linear filter, relative to its mean, so
+// that frequencies the patch hardly has are not amplified
+const double MosseTrackingModule::LINEAR_REGULARIZATION = 0.01;
+const double MosseTrackingModule::GAUSSIAN_REGULARIZATION = 1e-4;
+const double MosseTrackingModule::KERNEL_SIGMA = 0.2;
+// Bolme et al. report a PSR between 20 and 60 while tracking normally and
+// below 7 when the tracker fails
+const double MosseTrackingModule::FAILED_PSR = 7;
+const double MosseTrackingModule::GOOD_PSR = 20;
+
+// Vertex of the parabola through a maximum and its two neighbours, relative to
+// the maximum
+static float parabolaOffset(float before, float at, float after)
+{
+    float curvature = before - 2 * at + after;
+    if (curvature >= 0)
+        return 0;
+    return std::max(-0.5f, std::min(0.5f, 0.5f * (before - after) / curvature));
+}
+
+MosseTrackingModule::MosseTrackingModule(double patchSizeRatio, CorrelationKernel kernel, double learningRate) :
+    sanityCheck(this),
+    kernel(kernel),
+    patchSizeRatio(patchSizeRatio),
+    learningRate(learningRate),
+    initialized(false),
+    imageSize(0, 0),
+    sourceSide(0),
+    scaleFactor(1),
+    psr(0),
+    patch(PATCH_SIDE, PATCH_SIDE, CV_8UC1),
+    sidelobeMask(PATCH_SIDE, PATCH_SIDE, CV_8UC1)
+{
+    cv::createHanningWindow(window, cv::Size(PATCH_SIDE, PATCH_SIDE), CV_32F);
+
+    cv::Mat target(PATCH_SIDE, PATCH_SIDE, CV_32F);
+    int middle = PATCH_SIDE / 2;
+    for (int y = 0; y < PATCH_SIDE; y++)
+    {
+        for (int x = 0; x < PATCH_SIDE; x++)
+        {
+            double distanceSq = (x - middle) * (x - middle) + (y - middle) * (y - middle);
+            target.at<float>(y, x) = (float) std::exp(-distanceSq / (2 * OUTPUT_SIGMA * OUTPUT_SIGMA));
+        }
+    }
+    cv::dft(target, targetSpectrum, cv::DFT_COMPLEX_OUTPUT);
+}
+
+TrackResult MosseTrackingModule::track(cv::Mat &frame)
+{
+    sanityCheck.checkInitialized();
+    sanityCheck.checkFrameNotEmpty(frame);
+    sanityCheck.checkFrameSize(frame);
+
+    // The patch is taken where the motion so far puts the feature
+    cv::Point2f predicted = predictor.predict().asCVPoint();
+    predicted.x = std::max(0.0f, std::min(predicted.x, imageSize.width - 1.0f));
+    predicted.y = std::max(0.0f, std::min(predicted.y, imageSize.height - 1.0f));
+    cv::Rect region = sourceRegion(predicted);
+    samplePatch(frame, region);
+    correlate();
+
+    double peakValue;
+    cv::Point peak;
+    cv::minMaxLoc(response, 0, &peakValue, 0, &peak);
+    psr = peakToSidelobeRatio(peak, peakValue);
+    if (psr < FAILED_PSR)
+    {
+        // Waits where the feature was last seen instead of drifting away
+        predictor.hold(Point(position));
+        return TrackResult();
+    }
+
+    cv::Point2f trackedPoint = toFrame(region, subPixelPeak(peak));
+    cv::Point2f currentPoint = trackedPoint;
+    sanityCheck.limitTPDelta(currentPoint, position);
+    double confidence = std::min(1.0, (psr - FAILED_PSR) / (GOOD_PSR - FAILED_PSR));
+    position = currentPoint;
+    Point imagePoint(position);
+    predictor.correct(imagePoint);
+
+    // A jump too large to be real motion means the filter locked onto something
+    // else, which it should not learn
+    if (currentPoint != trackedPoint)
+        confidence = 0;
+    else
+    {
+        samplePatch(frame, sourceRegion(position));
+        train(learningRate);
+    }
+
+    return TrackResult(imagePoint, true, confidence);
+}
+
+void MosseTrackingModule::setTrackPoint(cv::Mat &frame, Point point)
+{
+    sanityCheck.checkFrameNotEmpty(frame);
+
+    imageSize = frame.size();
+    if (point.X() < 0 || point.X() >= imageSize.width ||
+        point.Y() < 0 || point.Y() >= imageSize.height)
+    {
+        return;
+    }
+
+    sourceSide = std::max(1, cvRound(patchSizeRatio * imageSize.width));
+    scaleFactor = (double) PATCH_SIDE / sourceSide;
+    position = point.asCVPoint();
+    samplePatch(frame, sourceRegion(position));
+    train(1);
+    psr = 0;
+    predictor.reset(point, imageSize.width / 640.0);
+    initialized = true;
+}
+
+cv::Size MosseTrackingModule::getImageSize()
+{
+    return imageSize;
+}
+
+bool MosseTrackingModule::isInitialized()
+{
+    return initialized;
+}
+
+double MosseTrackingModule::getPeakToSidelobeRatio()
+{
+    return psr;
+}
+
+// Frame region whose middle patch pixel falls on center
+cv::Rect MosseTrackingModule::sourceRegion(cv::Point2f center)
+{
+    double middle = (PATCH_SIDE / 2 + 0.5) / scaleFactor - 0.5;
+    return cv::Rect(cvRound(center.x - middle), cvRound(center.y - middle), sourceSide, sourceSide);
+}
+
+cv::Point2f MosseTrackingModule::toFrame(cv::Rect region, cv::Point2f patchPoint)
+{
+    return cv::Point2f((float) (region.x + (patchPoint.x + 0.5) / scaleFactor - 0.5),
+                       (float) (region.y + (patchPoint.y + 0.5) / scaleFactor - 0.5));
+}
+
+// Grey region of the frame, with the parts outside the frame repeating its
+// border, scaled to the patch and windowed. Leaves its spectrum in spectrum.
+void MosseTrackingModule::samplePatch(cv::Mat &frame, cv::Rect region)
+{
+    cv::Rect inside = region & cv::Rect(cv::Point(0, 0), imageSize);
+    cv::Mat &greyBuffer = bufferPool->get(BUFFER_CORRELATION_GREY, region.size(), CV_8UC1);
+    cv::Mat grey = greyBuffer(cv::Rect(cv::Point(0, 0), inside.size()));
+    ASM::convertToGray(frame(inside), grey);
+    if (inside != region)
+    {
+        cv::Mat &padded = bufferPool->get(BUFFER_CORRELATION_PADDED, region.size(), CV_8UC1);
+        cv::copyMakeBorder(grey, padded, inside.y - region.y, region.br().y - inside.br().y,
+                           inside.x - region.x, region.br().x - inside.br().x, cv::BORDER_REPLICATE);
+        grey = padded;
+    }
+    cv::resize(grey, patch, patch.size(), 0, 0, sourceSide > PATCH_SIDE ? cv::INTER_AREA : cv::INTER_LINEAR);
+
+    if (kernel == CORRELATION_LINEAR)
+    {
+        // Log intensities with zero mean and unit variance, as in MOSSE, so
+        // that the filter does not depend on lighting
+        patch.convertTo(features, CV_32F, 1, 1);
+        cv::log(features, features);
+        cv::Scalar mean, deviation;
+        cv::meanStdDev(features, mean, deviation);
+        double scale = 1 / (deviation[0] + 1e-5);
+        features.convertTo(features, CV_32F, scale, -mean[0] * scale);
+    }
+    else
+    {
+        patch.convertTo(features, CV_32F, 1 / 255.0, -0.5);
+    }
+    cv::multiply(features, window, features);
+    cv::dft(features, spectrum, cv::DFT_COMPLEX_OUTPUT);
+}
+
+// Learns the filter for spectrum and blends it into the model with the given
+// weight (1 replaces the model)
+void MosseTrackingModule::train(double rate)
+{
+    if (kernel == CORRELATION_LINEAR)
+    {
+        cv::mulSpectrums(targetSpectrum, spectrum, update[0], 0, true);
+        cv::mulSpectrums(spectrum, spectrum, update[1], 0, true);
+        blend(numerator, update[0], rate);
+        blend(denominator, update[1], rate);
+        double regularization = LINEAR_REGULARIZATION * cv::mean(denominator)[0];
+        cv::add(denominator, cv::Scalar(regularization, 0), update[1]);
+        divideSpectrums(numerator, update[1], filter);
+    }
+    else
+    {
+        gaussianCorrelation(spectrum, spectrum, kernelSpectrum);
+        cv::add(kernelSpectrum, cv::Scalar(GAUSSIAN_REGULARIZATION, 0), kernelSpectrum);
+        divideSpectrums(targetSpectrum, kernelSpectrum, update[0]);
+        blend(alphaSpectrum, update[0], rate);
+        blend(modelSpectrum, spectrum, rate);
+    }
+}
+
+// Correlation response of the model over spectrum, peaking where the feature
+// moved to relative to the middle of the patch
+void MosseTrackingModule::correlate()
+{
+    if (kernel == CORRELATION_LINEAR)
+    {
+        cv::mulSpectrums(spectrum, filter, product, 0);
+    }
+    else
+    {
+        gaussianCorrelation(spectrum, modelSpectrum, kernelSpectrum);
+        cv::mulSpectrums(alphaSpectrum, kernelSpectrum, product, 0);
+    }
+    cv::idft(product, response, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+}
+
+// Spectrum of the Gaussian kernel between x and every cyclic shift of y
+void MosseTrackingModule::gaussianCorrelation(const cv::Mat &xf, const cv::Mat &yf, cv::Mat &kf)
+{
+    double area = PATCH_SIDE * PATCH_SIDE;
+    double xx = cv::norm(xf, cv::NORM_L2SQR) / area;
+    double yy = cv::norm(yf, cv::NORM_L2SQR) / area;
+    cv::mulSpectrums(xf, yf, product, 0, true);
+    cv::idft(product, correlation, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    // exp(-max(0, xx + yy - 2 xy) / (sigma^2 area))
+    correlation.convertTo(correlation, CV_32F, -2, xx + yy);
+    cv::max(correlation, 0, correlation);
+    correlation.convertTo(correlation, CV_32F, -1 / (KERNEL_SIGMA * KERNEL_SIGMA * area));
+    cv::exp(correlation, correlation);
+    cv::dft(correlation, kf, cv::DFT_COMPLEX_OUTPUT);
+}
+
+// Element-wise a / b of complex spectra, as a conj(b) / |b|^2
+void MosseTrackingModule::divideSpectrums(const cv::Mat &a, const cv::Mat &b, cv::Mat &quotient)
+{
+    cv::mulSpectrums(a, b, product, 0, true);
+    cv::mulSpectrums(b, b, power, 0, true);
+    // |b|^2 is real: copy it over the (zero) imaginary part to divide both parts by it
+    int fromTo[] = { 0, 1 };
+    cv::mixChannels(&power, 1, &power, 1, fromTo, 1);
+    cv::divide(product, power, quotient);
+}
+
+void MosseTrackingModule::blend(cv::Mat &model, const cv::Mat &update, double rate)
+{
+    if (rate >= 1 || model.empty())
+        update.copyTo(model);
+    else
+        cv::addWeighted(model, 1 - rate, update, rate, 0, model);
+}
+
+// Peak height over the spread of the response outside a small square around it
+double MosseTrackingModule::peakToSidelobeRatio(cv::Point peak, double peakValue)
+{
+    sidelobeMask.setTo(1);
+    cv::Rect exclusion(peak.x - PEAK_EXCLUSION, peak.y - PEAK_EXCLUSION, 2 * PEAK_EXCLUSION + 1, 2 * PEAK_EXCLUSION + 1);
+    sidelobeMask(exclusion & cv::Rect(0, 0, PATCH_SIDE, PATCH_SIDE)).setTo(0);
+    cv::Scalar mean, deviation;
+    cv::meanStdDev(response, mean, deviation, sidelobeMask);
+    return (peakValue - mean[0]) / std::max(deviation[0], 1e-5);
+}
+
+// The response is cyclic, so the neighbours of a peak on the border wrap around
+cv::Point2f MosseTrackingModule::subPixelPeak(cv::Point peak)
+{
+    int left = (peak.x + PATCH_SIDE - 1) % PATCH_SIDE;
+    int right = (peak.x + 1) % PATCH_SIDE;
+    int up = (peak.y + PATCH_SIDE - 1) % PATCH_SIDE;
+    int down = (peak.y + 1) % PATCH_SIDE;
+    float at = response.at<float>(peak);
+    return cv::Point2f(peak.x + parabolaOffset(response.at<float>(peak.y, left), at, response.at<float>(peak.y, right)),
+                       peak.y + parabolaOffset(response.at<float>(up, peak.x), at, response.at<float>(down, peak.x)));
+}
+
+} // namespace CMS
@@ -0,0 +1,108 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CMS_MOSSETRACKINGMODULE_H
+#define CMS_MOSSETRACKINGMODULE_H
+
+#include "TrackingModule.h"
+
+namespace CMS {
+
+enum CorrelationKernel
+{
+    CORRELATION_LINEAR,     // MOSSE
+    CORRELATION_GAUSSIAN    // KCF
+};
+
+// Correlation filter tracker on a small grey patch around the feature: MOSSE
+// (Bolme et al. 2010), or with a Gaussian kernel as in KCF (Henriques et al.
+// 2015). The filter is learnt in the frequency domain and blended with the one
+// learnt on each new frame, so the appearance model adapts gradually instead of
+// being replaced. The peak-to-sidelobe ratio (PSR) of the correlation response
+// gives the confidence; below FAILED_PSR the feature counts as lost and the
+// filter is left as it is until the feature is found again.
+class MosseTrackingModule : public ITrackingModule
+{
+public:
+    // patchSizeRatio: side of the frame region the patch is taken from, relative
+    // to the frame width. learningRate: weight of the newest frame in the filter.
+    MosseTrackingModule(double patchSizeRatio, CorrelationKernel kernel = CORRELATION_LINEAR, double learningRate = 0.125);
+    TrackResult track(cv::Mat &frame);
+    void setTrackPoint(cv::Mat &frame, Point point);
+    cv::Size getImageSize();
+    bool isInitialized();
+    double getPeakToSidelobeRatio(); // Of the last tracked frame
+
+private:
+    static const int PATCH_SIDE = 64;
+    static const int PEAK_EXCLUSION = 5; // Half side of the square around the peak left out of the sidelobe
+    static const double OUTPUT_SIGMA;
+    static const double LINEAR_REGULARIZATION;
+    static const double GAUSSIAN_REGULARIZATION;
+    static const double KERNEL_SIGMA;
+    static const double FAILED_PSR;
+    static const double GOOD_PSR;
+
+    TrackingModuleSanityCheck sanityCheck;
+    CorrelationKernel kernel;
+    double patchSizeRatio;
+    double learningRate;
+    bool initialized;
+    cv::Size imageSize;
+    int sourceSide;         // Side of the frame region the patch is sampled from
+    double scaleFactor;     // From the frame to the patch
+    cv::Point2f position;   // Of the feature, in frame coordinates
+    double psr;
+
+    cv::Mat window;             // Cosine window that fades the patch out towards its border
+    cv::Mat targetSpectrum;     // Desired response: a Gaussian peak in the middle of the patch
+    // Linear kernel: filter blended from its numerator and denominator.
+    // Gaussian kernel: blended patch spectrum and dual coefficients.
+    cv::Mat numerator;
+    cv::Mat denominator;
+    cv::Mat filter;
+    cv::Mat modelSpectrum;
+    cv::Mat alphaSpectrum;
+
+    // Kept from frame to frame so that they are allocated only once
+    cv::Mat patch;
+    cv::Mat features;
+    cv::Mat spectrum;
+    cv::Mat response;
+    cv::Mat sidelobeMask;
+    cv::Mat update[2];          // Terms of the model learnt from the current frame
+    cv::Mat kernelSpectrum;
+    cv::Mat product;
+    cv::Mat power;
+    cv::Mat correlation;
+
+    cv::Rect sourceRegion(cv::Point2f center);
+    cv::Point2f toFrame(cv::Rect region, cv::Point2f patchPoint);
+    void samplePatch(cv::Mat &frame, cv::Rect region);
+    void train(double rate);
+    void correlate();
+    void gaussianCorrelation(const cv::Mat &xf, const cv::Mat &yf, cv::Mat &kf);
+    void divideSpectrums(const cv::Mat &a, const cv::Mat &b, cv::Mat &quotient);
+    void blend(cv::Mat &model, const cv::Mat &update, double rate);
+    double peakToSidelobeRatio(cv::Point peak, double peakValue);
+    cv::Point2f subPixelPeak(cv::Point peak);
+};
+
+} // namespace CMS
+
+#endif // CMS_MOSSETRACKINGMODULE_H
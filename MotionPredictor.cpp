@@ -0,0 +1,138 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "MotionPredictor.h"
+
+namespace CMS {
+
+// In pixels of a 640 pixel wide frame
+const double MotionPredictor::ACCELERATION_STD = 2; // Per frame squared
+const double MotionPredictor::MEASUREMENT_STD = 1;
+
+MotionPredictor::MotionPredictor() :
+    initialized(false),
+    accelerationVariance(0),
+    measurementVariance(0)
+{
+}
+
+void MotionPredictor::reset(Point position, double scale)
+{
+    accelerationVariance = std::pow(ACCELERATION_STD * scale, 2);
+    measurementVariance = std::pow(MEASUREMENT_STD * scale, 2);
+    x.reset(position.X(), measurementVariance);
+    y.reset(position.Y(), measurementVariance);
+    initialized = true;
+}
+
+bool MotionPredictor::isInitialized()
+{
+    return initialized;
+}
+
+Point MotionPredictor::predict()
+{
+    x.predict(accelerationVariance);
+    y.predict(accelerationVariance);
+    return getPrediction();
+}
+
+void MotionPredictor::correct(Point measured)
+{
+    x.correct(measured.X(), measurementVariance);
+    y.correct(measured.Y(), measurementVariance);
+}
+
+void MotionPredictor::hold(Point position)
+{
+    x.hold(position.X());
+    y.hold(position.Y());
+}
+
+void MotionPredictor::inflate(double factor)
+{
+    Axis *axes[] = {&x, &y};
+    for (int i = 0; i < 2; i++)
+    {
+        axes[i]->p00 *= factor;
+        axes[i]->p01 *= factor;
+        axes[i]->p11 *= factor;
+    }
+}
+
+Point MotionPredictor::getPrediction()
+{
+    return Point(x.position, y.position);
+}
+
+Point MotionPredictor::getDeviation()
+{
+    return Point(std::sqrt(x.p00), std::sqrt(y.p00));
+}
+
+// The velocity is unknown at first, so it starts with a large variance
+void MotionPredictor::Axis::reset(double position, double measurementVariance)
+{
+    this->position = position;
+    velocity = 0;
+    p00 = measurementVariance;
+    p01 = 0;
+    p11 = 100 * measurementVariance;
+}
+
+// x = F x and P = F P F' + Q with F = [1 1; 0 1] and Q the white acceleration
+// noise q [1/4 1/2; 1/2 1]
+void MotionPredictor::Axis::predict(double accelerationVariance)
+{
+    position += velocity;
+    double q = accelerationVariance;
+    double n00 = p00 + 2 * p01 + p11 + q / 4;
+    double n01 = p01 + p11 + q / 2;
+    double n11 = p11 + q;
+    p00 = n00;
+    p01 = n01;
+    p11 = n11;
+}
+
+// Only the position is measured (H = [1 0])
+void MotionPredictor::Axis::correct(double measured, double measurementVariance)
+{
+    double innovation = measured - position;
+    double s = p00 + measurementVariance;
+    double k0 = p00 / s;
+    double k1 = p01 / s;
+    position += k0 * innovation;
+    velocity += k1 * innovation;
+    double n00 = (1 - k0) * p00;
+    double n01 = (1 - k0) * p01;
+    double n11 = p11 - k1 * p01;
+    p00 = n00;
+    p01 = n01;
+    p11 = n11;
+}
+
+// The uncertainty is kept, the position is not known any better than before
+void MotionPredictor::Axis::hold(double position)
+{
+    this->position = position;
+    velocity = 0;
+    p01 = 0;
+}
+
+} // namespace CMS
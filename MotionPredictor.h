@@ -0,0 +1,71 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_MOTIONPREDICTOR_H
+#define CMS_MOTIONPREDICTOR_H
+
+#include "Point.h"
+
+namespace CMS {
+
+// Constant velocity Kalman filter on the feature position, one frame per step.
+// Each axis is filtered independently with state (position, velocity).
+class MotionPredictor
+{
+public:
+    MotionPredictor();
+    // scale converts the noise levels, given for 640 pixel wide frames, to the frame size
+    void reset(Point position, double scale);
+    bool isInitialized();
+    // Advances one frame and returns the predicted position
+    Point predict();
+    void correct(Point measured);
+    // Stays at position without a velocity, e.g. while the feature is lost,
+    // instead of coasting on the last velocity
+    void hold(Point position);
+    // Makes the prediction less certain, e.g. after a poor match
+    void inflate(double factor);
+    Point getPrediction();
+    // Standard deviation of the predicted position along each axis
+    Point getDeviation();
+
+private:
+    static const double ACCELERATION_STD;
+    static const double MEASUREMENT_STD;
+
+    struct Axis
+    {
+        double position;
+        double velocity;
+        double p00, p01, p11; // Covariance
+
+        void reset(double position, double measurementVariance);
+        void predict(double accelerationVariance);
+        void correct(double measured, double measurementVariance);
+        void hold(double position);
+    };
+
+    bool initialized;
+    double accelerationVariance;
+    double measurementVariance;
+    Axis x;
+    Axis y;
+};
+
+} // namespace CMS
+
+#endif // CMS_MOTIONPREDICTOR_H
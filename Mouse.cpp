@@ -19,9 +19,12 @@
 #include <QDebug>
 
 #include "Mouse.h"
+#include "AsyncMouse.h"
 
 #ifdef Q_OS_LINUX
 #include <X11/Xlib.h>
+#include <X11/extensions/XTest.h>
+#include <string.h>
 #include <unistd.h>
 #elif defined Q_OS_WIN
 #include <Windows.h>
@@ -42,12 +45,14 @@ void IMouse::move(Point p)
 
 IMouse* MouseFactory::newMouse()
 {
+    // Button events are injected on their own thread so that a click never
+    // stalls frame processing
 #ifdef Q_OS_LINUX
-    return new LinuxMouse;
+    return new AsyncMouse(new LinuxMouse);
 #elif defined Q_OS_WIN
-    return new WindowsMouse;
+    return new AsyncMouse(new WindowsMouse);
 #elif defined Q_OS_MAC
-    return new MacMouse;
+    return new AsyncMouse(new MacMouse);
 #else
     std::runtime_error("Operating System not supported. Cannot control mouse.");
     return 0;
@@ -56,44 +61,104 @@ IMouse* MouseFactory::newMouse()
 
 #ifdef Q_OS_LINUX
 
-void LinuxMouse::move(double x, double y)
+LinuxMouse::LinuxMouse() :
+    display(XOpenDisplay(NULL)),
+    useXTest(false)
 {
-    Display *display;
-    Window root_window;
-
-    display = XOpenDisplay(NULL);
-
     if(display == NULL)
     {
         throw std::runtime_error("Couldn't open the display");
     }
 
-    root_window = XRootWindow(display, 0);
-    XSelectInput(display, root_window, KeyReleaseMask);
+    screen = DefaultScreen(display);
+    rootWindow = RootWindow(display, screen);
 
-    XWarpPointer(display, None, root_window, 0, 0, 0, 0, x, y);
+    int eventBase, errorBase, major, minor;
+    useXTest = XTestQueryExtension(display, &eventBase, &errorBase, &major, &minor);
+    if (!useXTest)
+        qWarning() << "XTest extension not available, falling back to XWarpPointer/XSendEvent";
+}
 
-    XFlush(display); // Flushes the output buffer, therefore updates the cursor's position.
+LinuxMouse::~LinuxMouse()
+{
     XCloseDisplay(display);
 }
 
+void LinuxMouse::move(double x, double y)
+{
+    QMutexLocker locker(&mutex);
+
+    if (useXTest)
+        XTestFakeMotionEvent(display, screen, (int) x, (int) y, CurrentTime);
+    else
+        XWarpPointer(display, None, rootWindow, 0, 0, 0, 0, (int) x, (int) y);
+
+    // Only flushes the request buffer, no round trip to the server
+    XFlush(display);
+}
+
 void LinuxMouse::click()
 {
-    Display *display = XOpenDisplay(NULL);
-    XEvent event;
+    if (useXTest)
+    {
+        QMutexLocker locker(&mutex);
+        // Press and release go out in the same flush
+        XTestFakeButtonEvent(display, Button1, True, CurrentTime);
+        XTestFakeButtonEvent(display, Button1, False, CurrentTime);
+        XFlush(display);
+    }
+    else
+    {
+        // The display is not held while the button is down, so that pointer
+        // motion from the tracking thread is not blocked meanwhile
+        press();
+        usleep(100000); // Time in microseconds
+        release();
+    }
+}
 
-    if(display == NULL)
+void LinuxMouse::press()
+{
+    QMutexLocker locker(&mutex);
+
+    if (useXTest)
     {
-        throw std::runtime_error("Couldn't open the display");
+        XTestFakeButtonEvent(display, Button1, True, CurrentTime);
+        XFlush(display);
+    }
+    else
+    {
+        sendButtonEvent(true);
+    }
+}
+
+void LinuxMouse::release()
+{
+    QMutexLocker locker(&mutex);
+
+    if (useXTest)
+    {
+        XTestFakeButtonEvent(display, Button1, False, CurrentTime);
+        XFlush(display);
+    }
+    else
+    {
+        sendButtonEvent(false);
     }
+}
 
+// Fallback for servers without XTest: delivers a synthetic button event to the
+// window under the pointer
+void LinuxMouse::sendButtonEvent(bool pressed)
+{
+    XEvent event;
     memset(&event, 0x00, sizeof(event));
 
-    event.type = ButtonPress;
+    event.type = pressed ? ButtonPress : ButtonRelease;
     event.xbutton.button = Button1;
     event.xbutton.same_screen = True;
 
-    XQueryPointer(display, RootWindow(display, DefaultScreen(display)), &event.xbutton.root, &event.xbutton.window, &event.xbutton.x_root, &event.xbutton.y_root, &event.xbutton.x, &event.xbutton.y, &event.xbutton.state);
+    XQueryPointer(display, rootWindow, &event.xbutton.root, &event.xbutton.window, &event.xbutton.x_root, &event.xbutton.y_root, &event.xbutton.x, &event.xbutton.y, &event.xbutton.state);
 
     event.xbutton.subwindow = event.xbutton.window;
 
@@ -104,22 +169,14 @@ void LinuxMouse::click()
         XQueryPointer(display, event.xbutton.window, &event.xbutton.root, &event.xbutton.subwindow, &event.xbutton.x_root, &event.xbutton.y_root, &event.xbutton.x, &event.xbutton.y, &event.xbutton.state);
     }
 
-    if(XSendEvent(display, PointerWindow, True, 0xfff, &event) == 0)
-    {
-        throw std::runtime_error("Button could not be pressed");
-    }
-    XFlush(display);
+    if (!pressed)
+        event.xbutton.state = 0x100;
 
-    usleep(100000); // Time in microseconds
-
-    event.type = ButtonRelease;
-    event.xbutton.state = 0x100;
     if(XSendEvent(display, PointerWindow, True, 0xfff, &event) == 0)
     {
-        throw std::runtime_error("Button could not be released");
+        throw std::runtime_error(pressed ? "Button could not be pressed" : "Button could not be released");
     }
     XFlush(display);
-    XCloseDisplay(display);
 }
 
 #elif defined Q_OS_WIN
@@ -130,15 +187,24 @@ void WindowsMouse::move(double x, double y)
 }
 
 void WindowsMouse::click()
+{
+    press();
+    release();
+}
+
+void WindowsMouse::press()
 {
     INPUT input={0};
     // left down
     input.type       = INPUT_MOUSE;
     input.mi.dwFlags = MOUSEEVENTF_LEFTDOWN;
     ::SendInput(1,&input,sizeof(INPUT));
+}
 
+void WindowsMouse::release()
+{
+    INPUT input={0};
     // left up
-    ::ZeroMemory(&input,sizeof(INPUT));
     input.type      = INPUT_MOUSE;
     input.mi.dwFlags  = MOUSEEVENTF_LEFTUP;
     ::SendInput(1,&input,sizeof(INPUT));
@@ -153,16 +219,30 @@ void MacMouse::move(double x, double y)
 }
 
 void MacMouse::click()
+{
+    press();
+    release();
+}
+
+void MacMouse::press()
 {
     // Get cursor position
     CGEventRef event = CGEventCreate(NULL);
     CGPoint cursor = CGEventGetLocation(event);
     CFRelease(event);
 
-    // Click
     // Mouse Down
     CGEventRef mouseDown = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseDown, cursor, kCGMouseButtonLeft);
     CGEventPost(kCGHIDEventTap, mouseDown);
+}
+
+void MacMouse::release()
+{
+    // Get cursor position
+    CGEventRef event = CGEventCreate(NULL);
+    CGPoint cursor = CGEventGetLocation(event);
+    CFRelease(event);
+
     // Mouse Up
     CGEventRef mouseUp = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseUp, cursor, kCGMouseButtonLeft);
     CGEventSetIntegerValueField(mouseUp, kCGMouseEventClickState, 1);
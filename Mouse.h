@@ -20,6 +20,10 @@
 
 #include <QObject> // Included to have the OS defines
 
+#ifdef Q_OS_LINUX
+#include <QMutex>
+#endif
+
 #include "Point.h"
 
 namespace CMS {
@@ -31,6 +35,8 @@ public:
     void move(Point p);
     virtual void move(double x, double y) = 0;
     virtual void click() = 0;
+    virtual void press() = 0;
+    virtual void release() = 0;
 };
 
 class MouseFactory
@@ -41,11 +47,28 @@ public:
 
 #ifdef Q_OS_LINUX
 
+// Keeps a single X connection open and injects events through XTest when the
+// server supports it, otherwise warps the pointer and sends synthetic clicks.
 class LinuxMouse : public IMouse
 {
 public:
+    LinuxMouse();
+    ~LinuxMouse();
     void move(double x, double y);
     void click();
+    void press();
+    void release();
+
+private:
+    struct _XDisplay *display;
+    unsigned long rootWindow;
+    int screen;
+    bool useXTest;
+    QMutex mutex;
+
+    void sendButtonEvent(bool pressed);
+    LinuxMouse(const LinuxMouse&);
+    LinuxMouse& operator=(const LinuxMouse&);
 };
 
 #elif defined Q_OS_WIN
@@ -55,6 +78,8 @@ class WindowsMouse : public IMouse
 public:
     void move(double x, double y);
     void click();
+    void press();
+    void release();
 };
 
 #elif defined Q_OS_MAC
@@ -64,6 +89,8 @@ class MacMouse : public IMouse
 public:
     void move(double x, double y);
     void click();
+    void press();
+    void release();
 };
 
 #endif
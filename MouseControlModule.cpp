@@ -18,14 +18,22 @@
 #include <stdexcept>
 
 #include "MouseControlModule.h"
+#include "Clock.h"
 #include "Monitor.h"
+#include "Profiler.h"
 
 namespace CMS {
 
 MouseControlModule::MouseControlModule(Settings &settings) :
+    MouseControlModule(settings, MouseFactory::newMouse(), KeyboardFactory::newKeyboard())
+{
+}
+
+// Takes ownership of mouse and keyboard
+MouseControlModule::MouseControlModule(Settings &settings, IMouse *mouse, IKeyboard *keyboard) :
     settings(settings),
-    mouse(MouseFactory::newMouse()),
-    keyboard(KeyboardFactory::newKeyboard()),
+    mouse(mouse),
+    keyboard(keyboard),
     initialized(false),
     screenReference(settings.getScreenResolution()/2),
     resetReference(true),
@@ -61,8 +69,10 @@ bool MouseControlModule::isInitialized()
     return initialized;
 }
 
-void MouseControlModule::update(Point featurePosition)
+void MouseControlModule::update(Point featurePosition, qint64 captureTime)
 {
+    ScopedStageTimer timer(STAGE_MOUSE_UPDATE);
+
     while (keyboard->hasNextEvent())
     {
         KeyEvent event = keyboard->nextEvent();
@@ -102,9 +112,9 @@ void MouseControlModule::update(Point featurePosition)
     }
     prevPointer = pointerPos;
     mouse->move(pointerPos);
+    latencyHistogram.add(Clock::nowMicros() - captureTime);
 
     // Check if should click
-    // TODO Should it be in another thread?
     if (settings.isClickingEnabled())
     {
         int elapsedTime = time.elapsed();
@@ -135,6 +145,11 @@ void MouseControlModule::update(Point featurePosition)
     }
 }
 
+LatencyHistogram &MouseControlModule::getLatencyHistogram()
+{
+    return latencyHistogram;
+}
+
 void MouseControlModule::restart()
 {
     resetReference = true;
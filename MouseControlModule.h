@@ -23,6 +23,7 @@
 #include "Point.h"
 #include "Mouse.h"
 #include "Keyboard.h"
+#include "LatencyHistogram.h"
 #include "Settings.h"
 
 namespace CMS {
@@ -31,12 +32,14 @@ class MouseControlModule
 {
 public:
     MouseControlModule(Settings &settings);
+    MouseControlModule(Settings &settings, IMouse *mouse, IKeyboard *keyboard);
     ~MouseControlModule();
     void setFeatureReference(Point featureReference);
     void setScreenReference(Point screenReference);
     Point getPrevPos();
     bool isInitialized();
-    void update(Point featurePosition);
+    void update(Point featurePosition, qint64 captureTime);
+    LatencyHistogram &getLatencyHistogram();
     void restart();
 
 private:
@@ -52,6 +55,7 @@ private:
     Point dwellReference;
     bool prevLoopClicked;
     Point prevPointer;
+    LatencyHistogram latencyHistogram; // From frame capture to pointer movement
 
     bool withinRadius(Point center, Point point, double radius);
 };
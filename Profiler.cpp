@@ -0,0 +1,126 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace CMS {
+
+const unsigned Profiler::RING_SIZE;
+std::atomic<bool> Profiler::enabled(false);
+
+Profiler::Profiler()
+{
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        for (unsigned i = 0; i < RING_SIZE; i++)
+            rings[stage].nanos[i] = 0;
+        rings[stage].written = 0;
+        rings[stage].start = 0;
+    }
+}
+
+Profiler &Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    Profiler::enabled = enabled;
+}
+
+const char *Profiler::stageName(ProfileStage stage)
+{
+    switch (stage)
+    {
+    case STAGE_FRAME: return "frame";
+    case STAGE_CONVERSION: return "conversion";
+    case STAGE_TRACK: return "track";
+    case STAGE_DETECTION: return "detection";
+    case STAGE_FACE_SEARCH: return "face_search";
+    case STAGE_FACE_FEATURES: return "face_features";
+    case STAGE_MOUSE_UPDATE: return "mouse_update";
+    case STAGE_PREVIEW: return "preview";
+    case STAGE_DRAW: return "draw";
+    case STAGE_DISPLAY: return "display";
+    default: return "unknown";
+    }
+}
+
+void Profiler::record(ProfileStage stage, qint64 nanos)
+{
+    Ring &ring = rings[stage];
+    unsigned index = ring.written.load(std::memory_order_relaxed);
+    ring.nanos[index % RING_SIZE].store(nanos, std::memory_order_relaxed);
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+StageStatistics Profiler::getStatistics(ProfileStage stage)
+{
+    Ring &ring = rings[stage];
+    // start is a past value of written, so reading it first keeps it behind
+    unsigned start = ring.start.load(std::memory_order_acquire);
+    unsigned written = ring.written.load(std::memory_order_acquire);
+    unsigned count = std::min(written - start, RING_SIZE);
+
+    std::vector<qint64> samples(count);
+    for (unsigned i = 0; i < count; i++)
+        samples[i] = ring.nanos[(written - count + i) % RING_SIZE].load(std::memory_order_relaxed);
+    std::sort(samples.begin(), samples.end());
+
+    StageStatistics statistics = {0, 0, 0, 0, 0};
+    if (count == 0)
+        return statistics;
+    double total = 0;
+    for (unsigned i = 0; i < count; i++)
+        total += samples[i];
+    statistics.samples = count;
+    statistics.minMillis = samples.front() / 1e6;
+    statistics.meanMillis = total / count / 1e6;
+    statistics.p99Millis = samples[(count - 1) * 99 / 100] / 1e6;
+    statistics.maxMillis = samples.back() / 1e6;
+    return statistics;
+}
+
+// Only moves the start of each ring up to what was written, so the threads
+// recording meanwhile keep sole ownership of the rings
+void Profiler::reset()
+{
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+        rings[stage].start.store(rings[stage].written.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+void Profiler::writeCsv(QTextStream &out)
+{
+    out << "stage,samples,min_ms,mean_ms,p99_ms,max_ms\n";
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        StageStatistics statistics = getStatistics((ProfileStage) stage);
+        out << stageName((ProfileStage) stage) << ","
+            << statistics.samples << ","
+            << statistics.minMillis << ","
+            << statistics.meanMillis << ","
+            << statistics.p99Millis << ","
+            << statistics.maxMillis << "\n";
+    }
+}
+
+} // namespace CMS
@@ -0,0 +1,111 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_PROFILER_H
+#define CMS_PROFILER_H
+
+#include <QString>
+#include <QTextStream>
+#include <atomic>
+
+#include "Clock.h"
+
+namespace CMS {
+
+enum ProfileStage
+{
+    STAGE_FRAME,            // Whole CameraMouseController::processFrame
+    STAGE_CONVERSION,       // Camera frame to cv::Mat
+    STAGE_TRACK,            // ITrackingModule::track
+    STAGE_DETECTION,        // FeatureInitializationModule::initializeFeature
+    STAGE_FACE_SEARCH,      // Downscaling, grey conversion and face cascade (part of detection)
+    STAGE_FACE_FEATURES,    // Face preparation and feature cascades (part of detection)
+    STAGE_MOUSE_UPDATE,     // MouseControlModule::update
+    STAGE_PREVIEW,          // Downscaling and colour conversion of the preview
+    STAGE_DRAW,             // Drawing the tracked feature on the preview
+    STAGE_DISPLAY,          // QPixmap conversion and QLabel::setPixmap (GUI thread)
+    STAGE_COUNT
+};
+
+struct StageStatistics
+{
+    int samples;
+    double minMillis;
+    double meanMillis;
+    double p99Millis;
+    double maxMillis;
+};
+
+// Keeps the latest durations of each pipeline stage in fixed size rings.
+// Each stage is written by a single thread and can be read (or reset) from
+// any thread without locking. When profiling is disabled timers only test a
+// flag.
+class Profiler
+{
+public:
+    static Profiler &instance();
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static const char *stageName(ProfileStage stage);
+    void record(ProfileStage stage, qint64 nanos);
+    StageStatistics getStatistics(ProfileStage stage);
+    void reset(); // Forgets the samples recorded so far
+    void writeCsv(QTextStream &out);
+
+private:
+    static const unsigned RING_SIZE = 1024;
+    struct Ring
+    {
+        std::atomic<qint64> nanos[RING_SIZE];
+        std::atomic<unsigned> written; // Only changed by the writer
+        std::atomic<unsigned> start; // Samples before it were reset
+    };
+    static std::atomic<bool> enabled;
+    Ring rings[STAGE_COUNT];
+
+    Profiler();
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+};
+
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(ProfileStage stage) :
+        stage(stage),
+        start(Profiler::isEnabled() ? Clock::nowNanos() : -1)
+    {}
+
+    ~ScopedStageTimer()
+    {
+        if (start >= 0)
+            Profiler::instance().record(stage, Clock::nowNanos() - start);
+    }
+
+private:
+    ProfileStage stage;
+    qint64 start;
+};
+
+inline bool Profiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+} // namespace CMS
+
+#endif // CMS_PROFILER_H
@@ -15,48 +15,63 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QMutexLocker>
+
 #include "Settings.h"
 #include "Monitor.h"
 
 namespace CMS {
 
 Settings::Settings(QObject *parent) :
+    Settings(MonitorFactory::newMonitor()->getResolution(), parent)
+{
+}
+
+// Used when there is no monitor to query (e.g. when replaying recorded video)
+Settings::Settings(Point screenResolution, QObject *parent) :
     QObject(parent),
     enableClicking(false),
     radiusRel(0.05),
-    screenResolution(MonitorFactory::newMonitor()->getResolution()),
+    screenResolution(screenResolution),
     reverseHorizontal(false),
-    autoDetectNose(true)
+    autoDetectNose(true),
+    tracker("template")
 {
 }
 
 bool Settings::isClickingEnabled()
 {
+    QMutexLocker locker(&mutex);
     return enableClicking;
 }
 
 double Settings::getDwellTime()
 {
+    QMutexLocker locker(&mutex);
     return dwellTime;
 }
 
 int Settings::getDwellTimeMillis()
 {
+    QMutexLocker locker(&mutex);
     return (int) (dwellTime * 1000);
 }
 
 Point Settings::getGain()
 {
+    QMutexLocker locker(&mutex);
     return Point(horizontalGain, verticalGain);
 }
 
 bool Settings::getReverseHorizontal()
 {
+    QMutexLocker locker(&mutex);
     return reverseHorizontal;
 }
 
 double Settings::getDamping()
 {
+    QMutexLocker locker(&mutex);
     double dp = 100;
     if (enableSmoothing)
         dp = damping;
@@ -65,6 +80,7 @@ double Settings::getDamping()
 
 double Settings::getResetFeatureDistThreshSq()
 {
+    QMutexLocker locker(&mutex);
     if (frameSize.empty()) return 0;
     Point threshReg = frameSize * 0.02;
     return threshReg * threshReg;
@@ -72,68 +88,100 @@ double Settings::getResetFeatureDistThreshSq()
 
 Point Settings::getFrameSize()
 {
+    QMutexLocker locker(&mutex);
     return frameSize;
 }
 
 bool Settings::isAutoDetectNoseEnabled()
 {
+    QMutexLocker locker(&mutex);
     return autoDetectNose;
 }
 
+QString Settings::getTracker()
+{
+    QMutexLocker locker(&mutex);
+    return tracker;
+}
+
+QVariantMap Settings::getTrackerParameters()
+{
+    QMutexLocker locker(&mutex);
+    return trackerParameters;
+}
+
 void Settings::setEnableClicking(bool enableClicking)
 {
+    QMutexLocker locker(&mutex);
     this->enableClicking = enableClicking;
 }
 
 void Settings::setDwellTime(double dwellTime)
 {
+    QMutexLocker locker(&mutex);
     this->dwellTime = dwellTime;
 }
 
 Point Settings::getScreenResolution()
 {
+    QMutexLocker locker(&mutex);
     return screenResolution;
 }
 
 double Settings::getDwellRadius()
 {
+    QMutexLocker locker(&mutex);
     return radiusRel * screenResolution.X();
 }
 
 void Settings::setHorizontalGain(int horizontalGain)
 {
+    QMutexLocker locker(&mutex);
     this->horizontalGain = horizontalGain;
 }
 
 void Settings::setVerticalGain(int verticalGain)
 {
+    QMutexLocker locker(&mutex);
     this->verticalGain = verticalGain;
 }
 
 void Settings::setReverseHorizontal(bool reverseHorizontal)
 {
+    QMutexLocker locker(&mutex);
     this->reverseHorizontal = reverseHorizontal;
 }
 
 void Settings::setEnableSmoothing(bool enableSmoothing)
 {
+    QMutexLocker locker(&mutex);
     this->enableSmoothing = enableSmoothing;
 }
 
 void Settings::setDampingPercent(int damping)
 {
+    QMutexLocker locker(&mutex);
     this->damping = damping / 100.0;
 }
 
 void Settings::setFrameSize(Point frameSize)
 {
+    QMutexLocker locker(&mutex);
     this->frameSize = frameSize;
 }
 
 void Settings::setAutoDetectNose(bool autoDetectNose)
 {
+    QMutexLocker locker(&mutex);
     this->autoDetectNose = autoDetectNose;
 }
 
+void Settings::setTracker(const QString &tracker, const QVariantMap &parameters)
+{
+    QMutexLocker locker(&mutex);
+    this->tracker = tracker;
+    trackerParameters = parameters;
+}
+
 } // namespace CMS
 
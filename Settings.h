@@ -18,17 +18,23 @@
 #ifndef CMS_SETTINGS_H
 #define CMS_SETTINGS_H
 
+#include <QMutex>
 #include <QObject>
+#include <QString>
+#include <QVariantMap>
 
 #include "Point.h"
 
 namespace CMS {
 
+// Written from the GUI thread and read by the tracking and detection
+// threads, so every field is accessed under the mutex
 class Settings : public QObject
 {
     Q_OBJECT
 public:
     explicit Settings(QObject *parent = 0);
+    explicit Settings(Point screenResolution, QObject *parent = 0);
 
     bool isClickingEnabled();
     double getDwellTime();
@@ -39,6 +45,8 @@ public:
     double getResetFeatureDistThreshSq();
     Point getFrameSize();
     bool isAutoDetectNoseEnabled();
+    QString getTracker();
+    QVariantMap getTrackerParameters();
 
 signals:
 
@@ -54,8 +62,11 @@ public slots:
     void setDampingPercent(int damping);
     void setFrameSize(Point frameSize);
     void setAutoDetectNose(bool autoDetectNose);
+    // A tracker registered in TrackingModuleRegistry and its parameters
+    void setTracker(const QString &tracker, const QVariantMap &parameters = QVariantMap());
 
 private:
+    QMutex mutex;
     bool enableClicking;
     double dwellTime;
     double radiusRel;
@@ -67,6 +78,8 @@ private:
     double damping;
     Point frameSize;
     bool autoDetectNose;
+    QString tracker;
+    QVariantMap trackerParameters;
 };
 
 } // namespace CMS
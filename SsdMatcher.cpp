@@ -0,0 +1,333 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CMS_SSD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CMS_SSD_NEON
+#include <arm_neon.h>
+#endif
+
+// AVX2 code is compiled per function so the rest of the program does not require it
+#if defined(CMS_SSD_X86) && defined(__GNUC__)
+#define CMS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CMS_TARGET_AVX2
+#endif
+
+#include "SsdMatcher.h"
+
+namespace CMS {
+
+// Sum of squared differences of n bytes. A row of a template of width w and c
+// channels has w * c bytes; the 32 bit sums hold rows of up to 66000 bytes.
+typedef uint32_t (*RowSsd)(const uchar *a, const uchar *b, int n);
+
+static uint32_t rowSsdScalar(const uchar *a, const uchar *b, int n)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+#ifdef CMS_SSD_X86
+
+static uint32_t rowSsdSse2(const uchar *a, const uchar *b, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t) _mm_cvtsi128_si32(acc) + rowSsdScalar(a + i, b + i, n - i);
+}
+
+CMS_TARGET_AVX2
+static uint32_t rowSsdAvx2(const uchar *a, const uchar *b, int n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (a + i)));
+        __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (b + i)));
+        __m256i d = _mm256_sub_epi16(va, vb);
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t) _mm_cvtsi128_si32(sum) + rowSsdScalar(a + i, b + i, n - i);
+}
+
+static bool cpuHasAvx2()
+{
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    return false;
+#endif
+}
+
+#endif // CMS_SSD_X86
+
+#ifdef CMS_SSD_NEON
+
+static uint32_t rowSsdNeon(const uchar *a, const uchar *b, int n)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint16x8_t lo = vabdl_u8(vget_low_u8(va), vget_low_u8(vb));
+        uint16x8_t hi = vabdl_u8(vget_high_u8(va), vget_high_u8(vb));
+        acc = vmlal_u16(acc, vget_low_u16(lo), vget_low_u16(lo));
+        acc = vmlal_u16(acc, vget_high_u16(lo), vget_high_u16(lo));
+        acc = vmlal_u16(acc, vget_low_u16(hi), vget_low_u16(hi));
+        acc = vmlal_u16(acc, vget_high_u16(hi), vget_high_u16(hi));
+    }
+    uint64x2_t pairs = vpaddlq_u32(acc);
+    uint32_t sum = (uint32_t) (vgetq_lane_u64(pairs, 0) + vgetq_lane_u64(pairs, 1));
+    return sum + rowSsdScalar(a + i, b + i, n - i);
+}
+
+#endif // CMS_SSD_NEON
+
+// Sum for the template at (x, y), abandoned once it reaches bound
+static uint64_t boundedSsd(const cv::Mat &image, const cv::Mat &tmpl, int x, int y, uint64_t bound, RowSsd rowSsd)
+{
+    int rowBytes = tmpl.cols * (int) tmpl.elemSize();
+    int offset = x * (int) image.elemSize();
+    uint64_t sum = 0;
+    for (int r = 0; r < tmpl.rows && sum < bound; r++)
+        sum += rowSsd(image.ptr<uchar>(y + r) + offset, tmpl.ptr<uchar>(r), rowBytes);
+    return sum;
+}
+
+static cv::Point search(const cv::Mat &image, const cv::Mat &tmpl, cv::Point expected, RowSsd rowSsd)
+{
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    cv::Point bestLoc(0, 0);
+
+    if (expected.x >= 0 && expected.y >= 0 &&
+        expected.x + tmpl.cols <= image.cols && expected.y + tmpl.rows <= image.rows)
+    {
+        // One above the expected sum, so that an equal sum earlier in row order still wins
+        best = boundedSsd(image, tmpl, expected.x, expected.y, best, rowSsd) + 1;
+        bestLoc = expected;
+    }
+
+    for (int y = 0; y + tmpl.rows <= image.rows; y++)
+    {
+        for (int x = 0; x + tmpl.cols <= image.cols; x++)
+        {
+            uint64_t sum = boundedSsd(image, tmpl, x, y, best, rowSsd);
+            // Strictly smaller keeps the first minimum in row order, as cv::minMaxLoc does
+            if (sum < best)
+            {
+                best = sum;
+                bestLoc = cv::Point(x, y);
+            }
+        }
+    }
+    return bestLoc;
+}
+
+static RowSsd bestRowSsd()
+{
+    switch (SsdMatcher::bestKernel())
+    {
+#ifdef CMS_SSD_X86
+    case SSD_SSE2:
+        return rowSsdSse2;
+    case SSD_AVX2:
+        return rowSsdAvx2;
+#endif
+#ifdef CMS_SSD_NEON
+    case SSD_NEON:
+        return rowSsdNeon;
+#endif
+    default:
+        return rowSsdScalar;
+    }
+}
+
+// Vertex of the parabola through (-1, left), (0, center), (1, right)
+static bool fitParabola(double left, double center, double right, float &offset, double &curvature)
+{
+    curvature = left + right - 2 * center;
+    if (curvature <= 0)
+        return false;
+    offset = (float) ((left - right) / (2 * curvature));
+    // The vertex is only within half a pixel if center really is the minimum
+    offset = std::max(-0.5f, std::min(0.5f, offset));
+    return true;
+}
+
+SsdKernel SsdMatcher::bestKernel()
+{
+#ifdef CMS_SSD_X86
+    static const SsdKernel kernel = cpuHasAvx2() ? SSD_AVX2 : SSD_SSE2;
+    return kernel;
+#elif defined(CMS_SSD_NEON)
+    return SSD_NEON;
+#else
+    return SSD_SCALAR;
+#endif
+}
+
+bool SsdMatcher::isSupported(SsdKernel kernel)
+{
+    switch (kernel)
+    {
+    case SSD_AUTO:
+    case SSD_OPENCV:
+    case SSD_SCALAR:
+        return true;
+#ifdef CMS_SSD_X86
+    case SSD_SSE2:
+        return true;
+    case SSD_AVX2:
+        return bestKernel() == SSD_AVX2;
+#endif
+#ifdef CMS_SSD_NEON
+    case SSD_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *SsdMatcher::kernelName(SsdKernel kernel)
+{
+    switch (kernel)
+    {
+    case SSD_AUTO: return "auto";
+    case SSD_OPENCV: return "opencv";
+    case SSD_SCALAR: return "scalar";
+    case SSD_SSE2: return "sse2";
+    case SSD_AVX2: return "avx2";
+    case SSD_NEON: return "neon";
+    default: return "unknown";
+    }
+}
+
+bool SsdMatcher::refine(const cv::Mat &image, const cv::Mat &tmpl, cv::Point best, cv::Point2f &offset, double &sharpness)
+{
+    if (best.x < 1 || best.y < 1 || best.x + tmpl.cols + 1 > image.cols || best.y + tmpl.rows + 1 > image.rows)
+        return false;
+
+    RowSsd rowSsd = bestRowSsd();
+    uint64_t unbounded = std::numeric_limits<uint64_t>::max();
+    double center = (double) boundedSsd(image, tmpl, best.x, best.y, unbounded, rowSsd);
+    double left = (double) boundedSsd(image, tmpl, best.x - 1, best.y, unbounded, rowSsd);
+    double right = (double) boundedSsd(image, tmpl, best.x + 1, best.y, unbounded, rowSsd);
+    double up = (double) boundedSsd(image, tmpl, best.x, best.y - 1, unbounded, rowSsd);
+    double down = (double) boundedSsd(image, tmpl, best.x, best.y + 1, unbounded, rowSsd);
+
+    double curvatureX, curvatureY;
+    if (!fitParabola(left, center, right, offset.x, curvatureX) ||
+        !fitParabola(up, center, down, offset.y, curvatureY))
+        return false;
+
+    sharpness = std::min(curvatureX, curvatureY) / (tmpl.total() * tmpl.elemSize());
+    return true;
+}
+
+double SsdMatcher::meanSquaredDifference(const cv::Mat &image, const cv::Mat &tmpl, cv::Point position)
+{
+    if (position.x < 0 || position.y < 0 || position.x + tmpl.cols > image.cols || position.y + tmpl.rows > image.rows)
+        throw std::invalid_argument("Template position outside the image");
+    uint64_t sum = boundedSsd(image, tmpl, position.x, position.y, std::numeric_limits<uint64_t>::max(), bestRowSsd());
+    return (double) sum / (tmpl.total() * tmpl.elemSize());
+}
+
+cv::Point SsdMatcher::findBest(const cv::Mat &image, const cv::Mat &tmpl, SsdKernel kernel, cv::Mat &result, cv::Point expected)
+{
+    if (image.type() != tmpl.type() || image.depth() != CV_8U)
+        throw std::invalid_argument("Image and template must have the same 8 bit type");
+    if (image.cols < tmpl.cols || image.rows < tmpl.rows)
+        throw std::invalid_argument("Template is larger than the image");
+
+    if (kernel == SSD_AUTO)
+        kernel = bestKernel();
+    if (!isSupported(kernel))
+        throw std::invalid_argument("SSD kernel not supported on this CPU");
+
+    switch (kernel)
+    {
+    case SSD_OPENCV:
+    {
+        // Only the position of the minimum is used, so the map is not normalized
+        cv::matchTemplate(image, tmpl, result, CV_TM_SQDIFF);
+        cv::Point minLoc;
+        cv::minMaxLoc(result, 0, 0, &minLoc, 0);
+        return minLoc;
+    }
+#ifdef CMS_SSD_X86
+    case SSD_SSE2:
+        return search(image, tmpl, expected, rowSsdSse2);
+    case SSD_AVX2:
+        return search(image, tmpl, expected, rowSsdAvx2);
+#endif
+#ifdef CMS_SSD_NEON
+    case SSD_NEON:
+        return search(image, tmpl, expected, rowSsdNeon);
+#endif
+    default:
+        return search(image, tmpl, expected, rowSsdScalar);
+    }
+}
+
+} // namespace CMS
@@ -0,0 +1,64 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_SSDMATCHER_H
+#define CMS_SSDMATCHER_H
+
+#include <cv.h>
+
+namespace CMS {
+
+enum SsdKernel
+{
+    SSD_AUTO,       // Fastest kernel supported by this CPU
+    SSD_OPENCV,     // cv::matchTemplate with CV_TM_SQDIFF
+    SSD_SCALAR,
+    SSD_SSE2,
+    SSD_AVX2,
+    SSD_NEON,
+    SSD_KERNEL_COUNT
+};
+
+// Finds where a small template matches best (smallest sum of squared
+// differences) without building the full result map. The argmin is tracked
+// while the sums are computed and a candidate is abandoned as soon as its
+// partial sum exceeds the best one so far. Evaluating the expected position
+// first (e.g. where the feature was on the last frame) makes that bound tight
+// from the start, so most candidates are abandoned after a few rows.
+class SsdMatcher
+{
+public:
+    static SsdKernel bestKernel();
+    static bool isSupported(SsdKernel kernel);
+    static const char *kernelName(SsdKernel kernel);
+    // Top-left corner of the best match of tmpl in image (same type, 8 bit, any number of channels).
+    // Ties go to the first position in row order, as with cv::minMaxLoc, whatever is expected.
+    // SSD_OPENCV writes its result map into result, the other kernels do not use it.
+    static cv::Point findBest(const cv::Mat &image, const cv::Mat &tmpl, SsdKernel kernel, cv::Mat &result,
+                              cv::Point expected = cv::Point(-1, -1));
+    // Fits a parabola along each axis through the SSD at best and its four neighbours. offset is the
+    // sub-pixel position of the minimum relative to best (within half a pixel) and sharpness the
+    // smaller of the two curvatures per template byte. Fails if best lies on the border of the
+    // search area or the surface does not curve upwards along both axes.
+    static bool refine(const cv::Mat &image, const cv::Mat &tmpl, cv::Point best, cv::Point2f &offset, double &sharpness);
+    // SSD of tmpl at position divided by the number of template bytes
+    static double meanSquaredDifference(const cv::Mat &image, const cv::Mat &tmpl, cv::Point position);
+};
+
+} // namespace CMS
+
+#endif // CMS_SSDMATCHER_H
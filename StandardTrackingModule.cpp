@@ -16,6 +16,7 @@
  */
 
 #include <qdebug.h>
+#include <algorithm>
 #include <opencv2/video/tracking.hpp>
 
 #include "StandardTrackingModule.h"
@@ -23,44 +24,124 @@
 
 namespace CMS {
 
-StandardTrackingModule::StandardTrackingModule() :
+const float StandardTrackingModule::MAX_FB_ERROR = 2;
+// Mean absolute difference of the window around a tracked point, in grey
+// levels, at which the point is not trusted at all
+const float StandardTrackingModule::MAX_LK_ERROR = 40;
+
+static float median(std::vector<float> &values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+StandardTrackingModule::StandardTrackingModule(LucasKanadeMode mode) :
     sanityCheck(this),
+    mode(mode),
     initialized(false),
     winSize(10, 10),
+    maxLevel(3),
     criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03),
     imageSize(0,0)
 {
+    int spread = 0;
+    if (mode == LK_MEDIAN_FLOW)
+    {
+        // Outliers are voted out by the other points, so a smaller window and
+        // fewer levels are enough
+        winSize = cv::Size(7, 7);
+        maxLevel = 2;
+        spread = 2 * SEED_RADIUS;
+    }
+
+    // The region must hold the search window at the coarsest pyramid level
+    // wherever the point may have moved to. It is centred on the prediction,
+    // which leads the previous point by up to MAX_TP_DELTA, and the point may
+    // move up to MAX_TP_DELTA from the previous one
+    int radius = 2 * TrackingModuleSanityCheck::MAX_TP_DELTA + spread +
+            (std::max(winSize.width, winSize.height) / 2 + 1) * (1 << maxLevel);
+    int alignment = 1 << maxLevel;
+    int side = (2 * radius + alignment - 1) / alignment * alignment;
+    regionSize = cv::Size(side, side);
+
+    // The seed grid may hold more points than the corners
+    int gridSide = 2 * SEED_RADIUS / (SEED_RADIUS / 2) + 1;
+    int gridPoints = gridSide * gridSide + MIN_FLOW_POINTS;
+    size_t capacity = gridPoints > MAX_FLOW_POINTS ? gridPoints : MAX_FLOW_POINTS;
+    flowPoints.reserve(capacity);
+    prevPoints.reserve(capacity);
+    currentPoints.reserve(capacity);
+    backPoints.reserve(capacity);
+    keptPoints.reserve(capacity);
+    forwardFound.reserve(capacity);
+    backwardFound.reserve(capacity);
+    tracked.reserve(capacity);
+    errors.reserve(capacity);
+    sortedErrors.reserve(capacity);
+    dx.reserve(capacity);
+    dy.reserve(capacity);
 }
 
-Point StandardTrackingModule::track(cv::Mat &frame)
+TrackResult StandardTrackingModule::track(cv::Mat &frame)
 {
     sanityCheck.checkInitialized();
     sanityCheck.checkFrameNotEmpty(frame);
     sanityCheck.checkFrameSize(frame);
 
-    cv::Mat grey = ASM::convertToGray(frame);
+    // The search starts from where the motion so far puts the point, which
+    // is never further than the point itself may move
+    cv::Point2f motion = predictor.predict().asCVPoint() - prevTrackPoints[0];
+    double motionNorm = cv::norm(motion);
+    if (motionNorm > TrackingModuleSanityCheck::MAX_TP_DELTA)
+        motion *= (float) (TrackingModuleSanityCheck::MAX_TP_DELTA / motionNorm);
+    cv::Point2f predicted = prevTrackPoints[0] + motion;
 
-    //SwapPoints(ref _current_track_points[0], ref _last_track_points[0]);
+    cv::Rect region = regionAround(predicted);
+    cv::Point2f origin(region.x, region.y);
+    buildPyramid(frame, region, pyramid);
 
-    std::vector<uchar> featuresFound;
-    cv::Mat err;
-    std::vector<cv::Point2f> currentTrackPoints;
-    cv::calcOpticalFlowPyrLK(prevGrey, grey, prevTrackPoints, currentTrackPoints,
-                             featuresFound, err, winSize, 3, criteria);
+    cv::Point2f currentTrackPoint = prevTrackPoints[0];
+    double confidence = 0;
+    bool found = mode == LK_MEDIAN_FLOW ?
+                trackMedianFlow(origin, motion, currentTrackPoint, confidence) :
+                trackSinglePoint(origin, motion, currentTrackPoint, confidence);
 
     Point imagePoint;
 
-    sanityCheck.limitTPDelta(currentTrackPoints[0], prevTrackPoints[0]);
+    cv::Point2f trackedPoint = currentTrackPoint;
+    sanityCheck.limitTPDelta(currentTrackPoint, prevTrackPoints[0]);
+    // A jump too large to be real motion means the point slipped off the feature
+    if (currentTrackPoint != trackedPoint)
+        confidence = 0;
 
-    if (featuresFound[0])
+    if (found)
     {
-        imagePoint = Point(currentTrackPoints[0]);
+        imagePoint = Point(currentTrackPoint);
+        predictor.correct(imagePoint);
+    }
+    else
+    {
+        // Waits where the feature was last seen instead of drifting away
+        predictor.hold(Point(prevTrackPoints[0]));
     }
 
-    prevGrey = grey;
-    prevTrackPoints = currentTrackPoints;
+    std::swap(prevPyramid, pyramid);
+    prevOrigin = origin;
+    prevTrackPoints[0] = currentTrackPoint;
 
-    return imagePoint;
+    if (mode == LK_MEDIAN_FLOW)
+    {
+        // Start over from the current frame if the points were rejected as a
+        // whole or too many of them were lost
+        if (currentTrackPoint != trackedPoint)
+            flowPoints.clear();
+        pruneFlowPoints(currentTrackPoint);
+        if ((int) flowPoints.size() < MIN_FLOW_POINTS)
+            seedFlowPoints(prevPyramid, prevOrigin, currentTrackPoint);
+    }
+
+    // Lucas-Kanade positions are sub-pixel
+    return TrackResult(imagePoint, true, confidence);
 }
 
 void StandardTrackingModule::setTrackPoint(cv::Mat &frame, Point point)
@@ -76,9 +157,15 @@ void StandardTrackingModule::setTrackPoint(cv::Mat &frame, Point point)
 
     initialized = true;
 
-    prevTrackPoints = std::vector<cv::Point2f>();
-    prevTrackPoints.push_back(point.asCVPoint());
-    prevGrey = ASM::convertToGray(frame);
+    prevTrackPoints.assign(1, point.asCVPoint());
+
+    cv::Rect region = regionAround(prevTrackPoints[0]);
+    prevOrigin = cv::Point2f(region.x, region.y);
+    buildPyramid(frame, region, prevPyramid);
+    predictor.reset(point, imageSize.width / 640.0);
+
+    if (mode == LK_MEDIAN_FLOW)
+        seedFlowPoints(prevPyramid, prevOrigin, prevTrackPoints[0]);
 }
 
 cv::Size StandardTrackingModule::getImageSize()
@@ -91,4 +178,166 @@ bool StandardTrackingModule::isInitialized()
     return initialized;
 }
 
+// Fixed size region centred on the point as far as the frame allows. The origin
+// is aligned to the coarsest pyramid level so that the pyramids of successive
+// regions sample the same pixels as a pyramid of the whole frame would.
+cv::Rect StandardTrackingModule::regionAround(cv::Point2f point)
+{
+    int alignment = 1 << maxLevel;
+    cv::Size size(std::min(regionSize.width, imageSize.width),
+                  std::min(regionSize.height, imageSize.height));
+    int x = std::max(0, std::min(cvRound(point.x) - size.width / 2, imageSize.width - size.width));
+    int y = std::max(0, std::min(cvRound(point.y) - size.height / 2, imageSize.height - size.height));
+    return cv::Rect(x / alignment * alignment, y / alignment * alignment, size.width, size.height);
+}
+
+// Only the region is converted to grey; grey input (e.g. the luma of a YUV
+// camera frame) is used in place. The pyramid must not point into the
+// frame, which is gone by the time the pyramid is used as the previous
+// one, so its first level is always copied. The pyramid levels keep their
+// buffers from frame to frame.
+void StandardTrackingModule::buildPyramid(cv::Mat &frame, cv::Rect region, std::vector<cv::Mat> &pyramid)
+{
+    cv::Mat grey;
+    if (frame.type() == CV_8UC1)
+    {
+        grey = frame(region);
+    }
+    else
+    {
+        grey = bufferPool->get(BUFFER_LK_GREY, region.size(), CV_8UC1);
+        ASM::convertToGray(frame(region), grey);
+    }
+    cv::buildOpticalFlowPyramid(grey, pyramid, winSize, maxLevel, true,
+                                cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, false);
+}
+
+// Both pyramids have the same size but their own origin, so the points are
+// given in the coordinates of each region and the predicted position is the
+// initial guess
+bool StandardTrackingModule::trackSinglePoint(cv::Point2f origin, cv::Point2f motion, cv::Point2f &trackPoint, double &confidence)
+{
+    prevPoints.assign(1, trackPoint - prevOrigin);
+    currentPoints.assign(1, trackPoint + motion - origin);
+    cv::calcOpticalFlowPyrLK(prevPyramid, pyramid, prevPoints, currentPoints,
+                             forwardFound, lkError, winSize, maxLevel, criteria,
+                             cv::OPTFLOW_USE_INITIAL_FLOW);
+
+    trackPoint = currentPoints[0] + origin;
+    confidence = std::max(0.0, 1 - (double) lkError.at<float>(0) / MAX_LK_ERROR);
+    return forwardFound[0] != 0;
+}
+
+// All points are tracked forward and then back again in one call each. Points
+// that do not come back to where they started (forward-backward error above
+// the median, or above MAX_FB_ERROR) are dropped and the track point moves by
+// the median displacement of the rest. The confidence is the fraction of points
+// kept, lowered as the median error approaches MAX_FB_ERROR.
+bool StandardTrackingModule::trackMedianFlow(cv::Point2f origin, cv::Point2f motion, cv::Point2f &trackPoint, double &confidence)
+{
+    if (flowPoints.empty())
+        return false;
+
+    prevPoints.resize(flowPoints.size());
+    currentPoints.resize(flowPoints.size());
+    for (size_t i = 0; i < flowPoints.size(); i++)
+    {
+        prevPoints[i] = flowPoints[i] - prevOrigin;
+        currentPoints[i] = flowPoints[i] + motion - origin;
+    }
+    backPoints.assign(prevPoints.begin(), prevPoints.end());
+
+    cv::calcOpticalFlowPyrLK(prevPyramid, pyramid, prevPoints, currentPoints,
+                             forwardFound, lkError, winSize, maxLevel, criteria,
+                             cv::OPTFLOW_USE_INITIAL_FLOW);
+    cv::calcOpticalFlowPyrLK(pyramid, prevPyramid, currentPoints, backPoints,
+                             backwardFound, lkError, winSize, maxLevel, criteria,
+                             cv::OPTFLOW_USE_INITIAL_FLOW);
+
+    tracked.clear();
+    errors.clear();
+    for (size_t i = 0; i < flowPoints.size(); i++)
+    {
+        if (forwardFound[i] && backwardFound[i])
+        {
+            tracked.push_back(i);
+            errors.push_back((float) cv::norm(backPoints[i] - prevPoints[i]));
+        }
+    }
+    if (tracked.empty())
+    {
+        flowPoints.clear();
+        return false;
+    }
+
+    sortedErrors.assign(errors.begin(), errors.end());
+    float medianError = median(sortedErrors);
+    float maxError = std::min(medianError, MAX_FB_ERROR);
+
+    // The inliers are collected in keptPoints and become the flow points
+    keptPoints.clear();
+    dx.clear();
+    dy.clear();
+    for (size_t k = 0; k < tracked.size(); k++)
+    {
+        if (errors[k] > maxError)
+            continue;
+        size_t i = tracked[k];
+        cv::Point2f moved = currentPoints[i] + origin;
+        dx.push_back(moved.x - flowPoints[i].x);
+        dy.push_back(moved.y - flowPoints[i].y);
+        keptPoints.push_back(moved);
+    }
+    confidence = (double) keptPoints.size() / flowPoints.size() *
+            std::max(0.0, 1 - (double) medianError / (2 * MAX_FB_ERROR));
+    flowPoints.swap(keptPoints);
+    if (flowPoints.empty())
+        return false;
+
+    trackPoint += cv::Point2f(median(dx), median(dy));
+    return true;
+}
+
+// Shi-Tomasi corners around the track point, topped up with a regular grid
+// where the face is too flat to have enough of them
+void StandardTrackingModule::seedFlowPoints(std::vector<cv::Mat> &pyramid, cv::Point2f origin, cv::Point2f center)
+{
+    flowPoints.clear();
+
+    cv::Mat &grey = pyramid[0];
+    cv::Point local(cvRound(center.x - origin.x), cvRound(center.y - origin.y));
+    cv::Rect seedRect = cv::Rect(local.x - SEED_RADIUS, local.y - SEED_RADIUS, 2 * SEED_RADIUS + 1, 2 * SEED_RADIUS + 1) &
+            cv::Rect(0, 0, grey.cols, grey.rows);
+    if (seedRect.area() > 0)
+    {
+        cv::goodFeaturesToTrack(grey(seedRect), keptPoints, MAX_FLOW_POINTS, 0.01, 3);
+        for (size_t i = 0; i < keptPoints.size(); i++)
+            flowPoints.push_back(keptPoints[i] + cv::Point2f(seedRect.x, seedRect.y) + origin);
+    }
+
+    if ((int) flowPoints.size() < MIN_FLOW_POINTS)
+    {
+        int step = SEED_RADIUS / 2;
+        for (int y = -SEED_RADIUS; y <= SEED_RADIUS; y += step)
+        {
+            for (int x = -SEED_RADIUS; x <= SEED_RADIUS; x += step)
+                flowPoints.push_back(center + cv::Point2f(x, y));
+        }
+    }
+}
+
+// Points that drifted away from the track point would leave the region
+void StandardTrackingModule::pruneFlowPoints(cv::Point2f center)
+{
+    float maxDistance = 2 * SEED_RADIUS;
+    keptPoints.clear();
+    for (size_t i = 0; i < flowPoints.size(); i++)
+    {
+        cv::Point2f d = flowPoints[i] - center;
+        if (d.x * d.x + d.y * d.y <= maxDistance * maxDistance)
+            keptPoints.push_back(flowPoints[i]);
+    }
+    flowPoints.swap(keptPoints);
+}
+
 } // namespace CMS
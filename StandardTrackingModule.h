@@ -26,23 +26,64 @@
 
 namespace CMS {
 
+enum LucasKanadeMode
+{
+    LK_SINGLE_POINT,    // Tracks the feature point alone
+    LK_MEDIAN_FLOW      // Tracks a set of points around it and moves by their median flow
+};
+
 class StandardTrackingModule : public ITrackingModule
 {
 public:
-    StandardTrackingModule();
-    Point track(cv::Mat &frame);
+    explicit StandardTrackingModule(LucasKanadeMode mode = LK_SINGLE_POINT);
+    TrackResult track(cv::Mat &frame);
     void setTrackPoint(cv::Mat &frame, Point point);
     cv::Size getImageSize();
     bool isInitialized();
 
 private:
+    static const int SEED_RADIUS = 10;
+    static const int MIN_FLOW_POINTS = 6;
+    static const int MAX_FLOW_POINTS = 25;
+    static const float MAX_FB_ERROR;
+    static const float MAX_LK_ERROR;
+
     TrackingModuleSanityCheck sanityCheck;
+    LucasKanadeMode mode;
     bool initialized;
     cv::Size winSize;
+    int maxLevel;
     cv::TermCriteria criteria;
-    cv::Mat prevGrey;
+    cv::Size regionSize;
+    // Pyramids of the region around the track point, each with the origin of
+    // its region. The current pyramid becomes the previous one on the next frame.
+    std::vector<cv::Mat> prevPyramid;
+    cv::Point2f prevOrigin;
+    std::vector<cv::Mat> pyramid;
     std::vector<cv::Point2f> prevTrackPoints;
+    std::vector<cv::Point2f> flowPoints; // Median flow points in frame coordinates
+    // Per frame scratch space, reserved for MAX_FLOW_POINTS (or the seed grid)
+    // so that tracking does not allocate
+    std::vector<cv::Point2f> prevPoints;
+    std::vector<cv::Point2f> currentPoints;
+    std::vector<cv::Point2f> backPoints;
+    std::vector<cv::Point2f> keptPoints;
+    std::vector<uchar> forwardFound;
+    std::vector<uchar> backwardFound;
+    cv::Mat lkError;
+    std::vector<size_t> tracked;
+    std::vector<float> errors;
+    std::vector<float> sortedErrors;
+    std::vector<float> dx;
+    std::vector<float> dy;
     cv::Size imageSize;
+
+    cv::Rect regionAround(cv::Point2f point);
+    void buildPyramid(cv::Mat &frame, cv::Rect region, std::vector<cv::Mat> &pyramid);
+    bool trackSinglePoint(cv::Point2f origin, cv::Point2f motion, cv::Point2f &trackPoint, double &confidence);
+    bool trackMedianFlow(cv::Point2f origin, cv::Point2f motion, cv::Point2f &trackPoint, double &confidence);
+    void seedFlowPoints(std::vector<cv::Mat> &pyramid, cv::Point2f origin, cv::Point2f center);
+    void pruneFlowPoints(cv::Point2f center);
 };
 
 } // namespace CMS
@@ -15,6 +15,8 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <stdexcept>
 #include <QObject>
 #if defined(Q_OS_LINUX) || defined(Q_OS_WIN32)
 #include <opencv2/imgproc.hpp>
@@ -22,46 +24,189 @@
 
 #include "TemplateTrackingModule.h"
 #include "ImageProcessing.h"
+#include "asmOpenCV.h"
 
 namespace CMS {
 
-TemplateTrackingModule::TemplateTrackingModule(double templateSizeRatio) :
+// Smallest curvature of the coarse SSD surface per template byte (roughly the
+// mean squared intensity gradient) for which the coarse match alone is trusted
+const double TemplateTrackingModule::MIN_PEAK_SHARPNESS = 20;
+// A match whose mean squared difference exceeds the running average by this
+// ratio widens the search
+const double TemplateTrackingModule::DEGRADED_SCORE_RATIO = 2.5;
+const double TemplateTrackingModule::SCORE_SMOOTHING = 0.1;
+const double TemplateTrackingModule::WIDEN_FACTOR = 4;
+// Sizes tried on either side of the current one, as a ratio
+const double TemplateTrackingModule::SCALE_STEP = 1.1;
+// A size only takes over when it matches clearly better, so that the template
+// does not flicker between sizes
+const double TemplateTrackingModule::SCALE_SWITCH_RATIO = 0.85;
+const double TemplateTrackingModule::MIN_FEATURE_SCALE = 0.5;
+const double TemplateTrackingModule::MAX_FEATURE_SCALE = 2;
+
+TemplateTrackingModule::TemplateTrackingModule(double templateSizeRatio, bool greyMatching) :
     sanityCheck(this),
     initialized(false),
+    greyMatching(greyMatching),
     workingWidth(640),
     templateSizeRatio(templateSizeRatio),
-    templateSize((Point(workingWidth, workingWidth)*templateSizeRatio).asCVIntPoint())
+    templateSize((Point(workingWidth, workingWidth)*templateSizeRatio).asCVIntPoint()),
+    matchKernel(SsdMatcher::bestKernel()),
+    subPixelRefinement(false),
+    scaleAdaptation(false),
+    featureScale(1),
+    typicalScore(-1)
+{
+}
+
+void TemplateTrackingModule::setMatchKernel(SsdKernel kernel)
+{
+    if (!SsdMatcher::isSupported(kernel))
+        throw std::invalid_argument("SSD kernel not supported on this CPU");
+    matchKernel = kernel == SSD_AUTO ? SsdMatcher::bestKernel() : kernel;
+}
+
+SsdKernel TemplateTrackingModule::getMatchKernel()
+{
+    return matchKernel;
+}
+
+void TemplateTrackingModule::setSubPixelRefinement(bool enabled)
 {
+    subPixelRefinement = enabled;
 }
 
-Point TemplateTrackingModule::track(cv::Mat &frame)
+void TemplateTrackingModule::setScaleAdaptation(bool enabled)
+{
+    scaleAdaptation = enabled;
+}
+
+TrackResult TemplateTrackingModule::track(cv::Mat &frame)
 {
     sanityCheck.checkInitialized();
     sanityCheck.checkFrameNotEmpty(frame);
     sanityCheck.checkFrameSize(frame);
 
-    cv::Mat smallFrame = workingFrame(frame);
+    // Match template (only look in a window around the predicted position, as
+    // large as the uncertainty of the prediction)
+    // The prediction may leave the frame, template centres can not
+    Point predicted = predictor.predict();
+    predicted = Point(std::max((double) fullTemplateSize.width / 2, std::min(predicted.X(), (double) (fullImageSize.width - fullTemplateSize.width / 2 - 1))),
+                      std::max((double) fullTemplateSize.height / 2, std::min(predicted.Y(), (double) (fullImageSize.height - fullTemplateSize.height / 2 - 1))));
+    cv::Size maxSearchSize(fullImageSize.width / 3, fullImageSize.height / 3);
+    cv::Size searchSize = predictedSearchSize(maxSearchSize);
+    cv::Rect region;
+    cv::Mat smallRegion;
+    cv::Point matchLoc = coarseMatch(frame, predicted, searchSize, maxSearchSize, region, smallRegion);
+
+    // A much poorer match than usual suggests the feature left a narrow window:
+    // search the whole window around the previous position and trust the prediction less
+    double score = SsdMatcher::meanSquaredDifference(smallRegion, templ, matchLoc);
+    if (searchSize != maxSearchSize && typicalScore >= 0 && score > DEGRADED_SCORE_RATIO * typicalScore)
+    {
+        predictor.inflate(WIDEN_FACTOR);
+        matchLoc = coarseMatch(frame, prevLoc, maxSearchSize, maxSearchSize, region, smallRegion);
+        score = SsdMatcher::meanSquaredDifference(smallRegion, templ, matchLoc);
+    }
+    double scale = 1;
+    cv::Point2f scaledCenter;
+    bool rescaled = scaleAdaptation && matchScales(smallRegion, matchLoc, score, scale, scaledCenter);
+    double confidence = matchConfidence(score);
+    typicalScore = typicalScore < 0 ? score : (1 - SCORE_SMOOTHING) * typicalScore + SCORE_SMOOTHING * score;
+
+    if (rescaled)
+    {
+        // The feature changed size: new templates of the new size are taken
+        // where it was found, which makes the fine pass pointless for this frame
+        featureScale = std::max(MIN_FEATURE_SCALE, std::min(featureScale * scale, MAX_FEATURE_SCALE));
+        updateTemplateSizes(fullImageSize);
+        prevLoc = Point(region.x + (scaledCenter.x + 0.5) / scaleFactor - 0.5,
+                        region.y + (scaledCenter.y + 0.5) / scaleFactor - 0.5);
+        extractTemplates(frame, prevLoc);
+        predictor.correct(prevLoc);
+        return TrackResult(prevLoc, false, confidence);
+    }
 
-    // Match template (only look in a region around the previous position)
-    cv::Size searchSize(smallFrame.size().width / 3, smallFrame.size().height / 3);
-    cv::Point matchLoc = match(smallFrame, templ, imageSize - templateSize, (prevLoc * scaleFactor).asCVIntPoint(), searchSize);
-    // Update template for scaled image
+    cv::Point2f subPixelOffset;
+    double sharpness;
+    bool coarseRefined = subPixelRefinement &&
+            SsdMatcher::refine(smallRegion, templ, matchLoc, subPixelOffset, sharpness) &&
+            sharpness >= MIN_PEAK_SHARPNESS;
+    // Update template for scaled image (copied, smallRegion is reused for the next frame)
     cv::Rect roi(matchLoc.x, matchLoc.y, templateSize.width, templateSize.height);
-    templ = smallFrame(roi);
+    smallRegion(roi).copyTo(templ);
+
+    if (coarseRefined)
+    {
+        // Center of the refined match, mapped back through the downscaling
+        double x = region.x + (matchLoc.x + subPixelOffset.x + (templateSize.width - 1) / 2.0 + 0.5) / scaleFactor - 0.5;
+        double y = region.y + (matchLoc.y + subPixelOffset.y + (templateSize.height - 1) / 2.0 + 0.5) / scaleFactor - 0.5;
+        // Keep the full resolution template current for frames that do need the fine pass
+        cv::Point fullOrigin = adjustPoint(cv::Point(cvRound(x) - fullTemplateSize.width / 2, cvRound(y) - fullTemplateSize.height / 2),
+                                           fullImageSize - fullTemplateSize);
+        storeTemplate(frame(cv::Rect(fullOrigin, fullTemplateSize)), fullTempl);
+        prevLoc = Point(x, y);
+        predictor.correct(prevLoc);
+        return TrackResult(prevLoc, true, confidence);
+    }
 
     // Match template for full image (only look a few pixels around the matched region
-    cv::Point searchCenter((int) (matchLoc.x / scaleFactor + fullTemplateSize.width / 2),
-                           (int) (matchLoc.y / scaleFactor + fullTemplateSize.height / 2));
+    cv::Point searchCenter((int) (region.x + matchLoc.x / scaleFactor + fullTemplateSize.width / 2),
+                           (int) (region.y + matchLoc.y / scaleFactor + fullTemplateSize.height / 2));
     searchSize = cv::Size(fullTemplateSize.width + (int) 10 / scaleFactor,
                           fullTemplateSize.height + (int) 10 / scaleFactor);
-    matchLoc = match(frame, fullTempl, fullImageSize - fullTemplateSize, searchCenter, searchSize);
-    // Update template for full image
+    cv::Point expected = searchCenter - cv::Point(fullTemplateSize.width / 2, fullTemplateSize.height / 2);
+    // Only the searched part of the frame is converted for matching
+    cv::Rect fullRegion = searchRegion(searchCenter, searchSize, fullImageSize);
+    cv::Mat fullArea = matchingImage(frame(fullRegion), BUFFER_FULL_SEARCH_GREY, searchSize);
+    cv::Point offset = fullRegion.tl();
+    matchLoc = offset + match(fullArea, fullTempl, fullImageSize - fullTemplateSize - cv::Size(offset.x, offset.y),
+                              searchCenter - offset, searchSize, expected - offset, BUFFER_FULL_MATCH_RESULT);
+    bool fineRefined = subPixelRefinement &&
+            SsdMatcher::refine(fullArea, fullTempl, matchLoc - offset, subPixelOffset, sharpness);
+    if (!fineRefined)
+        subPixelOffset = cv::Point2f(0, 0);
+    // Update template for full image (copied, the frame buffer is only valid during this call)
     cv::Rect fullRoi(matchLoc.x, matchLoc.y, fullTemplateSize.width, fullTemplateSize.height);
-    fullTempl = frame(fullRoi);
+    storeTemplate(frame(fullRoi), fullTempl);
 
     // Return center of matched region
-    prevLoc = Point(matchLoc.x + fullTemplateSize.width/2, matchLoc.y + fullTemplateSize.height/2);
-    return prevLoc;
+    prevLoc = Point(matchLoc.x + fullTemplateSize.width/2 + subPixelOffset.x, matchLoc.y + fullTemplateSize.height/2 + subPixelOffset.y);
+    predictor.correct(prevLoc);
+    return TrackResult(prevLoc, fineRefined, confidence);
+}
+
+// Matches the scaled template in the downscaled searchSize region around center
+cv::Point TemplateTrackingModule::coarseMatch(cv::Mat &frame, Point center, cv::Size searchSize, cv::Size maxSearchSize, cv::Rect &region, cv::Mat &smallRegion)
+{
+    // The region is cropped at full resolution and only the crop is downscaled
+    region = searchRegion(center.asCVIntPoint(), searchSize, fullImageSize);
+    smallRegion = workingRegion(frame, region, maxSearchSize);
+    smallRegion = matchingImage(smallRegion, BUFFER_WORKING_GREY, workingSize(maxSearchSize));
+    cv::Point regionCenter(smallRegion.size().width / 2, smallRegion.size().height / 2);
+    cv::Point expected(cvRound((center.X() - region.x) * scaleFactor) - templateSize.width / 2,
+                       cvRound((center.Y() - region.y) * scaleFactor) - templateSize.height / 2);
+    return match(smallRegion, templ, smallRegion.size() - templateSize + cv::Size(1, 1), regionCenter, smallRegion.size(), expected, BUFFER_MATCH_RESULT);
+}
+
+// Three standard deviations of the prediction either way of the template, plus
+// a margin of a few pixels of the working image
+cv::Size TemplateTrackingModule::predictedSearchSize(cv::Size maxSearchSize)
+{
+    Point deviation = predictor.getDeviation();
+    double margin = MIN_SEARCH_MARGIN / scaleFactor;
+    int width = fullTemplateSize.width + 2 * cvCeil(3 * deviation.X() + margin);
+    int height = fullTemplateSize.height + 2 * cvCeil(3 * deviation.Y() + margin);
+    return cv::Size(std::min(width, maxSearchSize.width), std::min(height, maxSearchSize.height));
+}
+
+// Full confidence for matches as good as usual, falling in proportion as the
+// match gets worse than that
+double TemplateTrackingModule::matchConfidence(double score)
+{
+    if (typicalScore < 0 || score <= typicalScore)
+        return 1;
+    return typicalScore / score;
 }
 
 void TemplateTrackingModule::setTrackPoint(cv::Mat &frame, Point point)
@@ -69,37 +214,105 @@ void TemplateTrackingModule::setTrackPoint(cv::Mat &frame, Point point)
     sanityCheck.checkFrameNotEmpty(frame);
 
     fullImageSize = frame.size();
-    fullTemplateSize = (Point(frame.size().width, frame.size().width)*templateSizeRatio).asCVIntPoint();
+    featureScale = 1;
+    updateTemplateSizes(fullImageSize);
     if (point.X() < 0 || point.X() >= fullImageSize.width ||
         point.Y() < 0 || point.Y() >= fullImageSize.height)
     {
         return;
     }
 
-    cv::Mat smallFrame = workingFrame(frame);
-    imageSize = smallFrame.size();
-    // scaleFactor is only set now
+    scaleFactor = (float) workingWidth / frame.size().width;
+    imageSize = cv::Size(cvRound(frame.size().width * (double) scaleFactor), cvRound(frame.size().height * (double) scaleFactor));
+    extractTemplates(frame, point);
+
+    prevLoc = point;
+    predictor.reset(point, fullImageSize.width / 640.0);
+    typicalScore = -1;
+    initialized = true;
+}
+
+// Sizes of the templates for the feature at its current scale
+void TemplateTrackingModule::updateTemplateSizes(cv::Size frameSize)
+{
+    double ratio = templateSizeRatio * featureScale;
+    templateSize = (Point(workingWidth, workingWidth)*ratio).asCVIntPoint();
+    fullTemplateSize = (Point(frameSize.width, frameSize.width)*ratio).asCVIntPoint();
+}
+
+// Takes both templates centred in point, as far as the frame allows
+void TemplateTrackingModule::extractTemplates(cv::Mat &frame, Point point)
+{
     Point scaledPoint = point * scaleFactor;
 
     // Get positions of the top-left corner of the region of interest (template) centered in (x,y) on the scaled image
     cv::Point roiOrigin = adjustPoint(scaledPoint.asCVIntPoint() - cv::Point(templateSize.width/2, templateSize.height/2), imageSize - templateSize);
-    cv::Rect roi(roiOrigin.x, roiOrigin.y, templateSize.width, templateSize.height);
-    templ = smallFrame(roi);
+    // Only the template region is downscaled
+    cv::Rect region(cv::Point(cvFloor(roiOrigin.x / scaleFactor), cvFloor(roiOrigin.y / scaleFactor)),
+                    cv::Point(cvCeil((roiOrigin.x + templateSize.width) / scaleFactor), cvCeil((roiOrigin.y + templateSize.height) / scaleFactor)));
+    region &= cv::Rect(0, 0, fullImageSize.width, fullImageSize.height);
+    cv::Mat smallTemplate;
+    cv::resize(frame(region), smallTemplate, templateSize);
+    storeTemplate(smallTemplate, templ);
 
     // Get positions of the top-left corner of the region of interest (template) centered in (x,y) on the full image
     cv::Point fullRoiOrigin = adjustPoint(point.asCVIntPoint() - cv::Point(fullTemplateSize.width/2, fullTemplateSize.height/2), fullImageSize - fullTemplateSize);
     cv::Rect fullRoi(fullRoiOrigin.x, fullRoiOrigin.y, fullTemplateSize.width, fullTemplateSize.height);
-    fullTempl = frame(fullRoi);
+    storeTemplate(frame(fullRoi), fullTempl);
+}
 
-    prevLoc = point;
-    initialized = true;
+// Matches the template around the coarse match in copies of the search region
+// scaled as if the feature had grown or shrunk by SCALE_STEP. Succeeds if one
+// of them matches clearly better, giving the scale of the feature relative to
+// the template and the centre of the match in smallRegion.
+bool TemplateTrackingModule::matchScales(cv::Mat &smallRegion, cv::Point matchLoc, double &score, double &scale, cv::Point2f &center)
+{
+    cv::Point2f matchCenter(matchLoc.x + (templateSize.width - 1) / 2.0f, matchLoc.y + (templateSize.height - 1) / 2.0f);
+    cv::Size searchSize = templateSize + cv::Size(2 * MIN_SEARCH_MARGIN, 2 * MIN_SEARCH_MARGIN);
+    cv::Size maxScaledSize = searchSize + cv::Size(2, 2);
+    double bestScore = SCALE_SWITCH_RATIO * score;
+    bool found = false;
+    const double scales[] = { 1 / SCALE_STEP, SCALE_STEP };
+    for (int i = 0; i < 2; i++)
+    {
+        double k = scales[i];
+        cv::Size size(cvRound(searchSize.width * k), cvRound(searchSize.height * k));
+        cv::Rect area = cv::Rect(cvRound(matchCenter.x + 0.5 - size.width / 2.0), cvRound(matchCenter.y + 0.5 - size.height / 2.0),
+                                 size.width, size.height) & cv::Rect(cv::Point(0, 0), smallRegion.size());
+        cv::Size scaledSize(std::min(cvRound(area.width / k), maxScaledSize.width),
+                            std::min(cvRound(area.height / k), maxScaledSize.height));
+        if (scaledSize.width < templateSize.width || scaledSize.height < templateSize.height)
+            continue;
+        cv::Mat scaled = poolView(BUFFER_SCALE_SEARCH, scaledSize, maxScaledSize, smallRegion.type());
+        cv::resize(smallRegion(area), scaled, scaledSize);
+
+        cv::Point scaledCenter(scaledSize.width / 2, scaledSize.height / 2);
+        cv::Point expected = scaledCenter - cv::Point(templateSize.width / 2, templateSize.height / 2);
+        cv::Point loc = match(scaled, templ, scaledSize - templateSize + cv::Size(1, 1), scaledCenter, scaledSize, expected, BUFFER_SCALE_MATCH_RESULT);
+        double scaledScore = SsdMatcher::meanSquaredDifference(scaled, templ, loc);
+        if (scaledScore < bestScore)
+        {
+            bestScore = scaledScore;
+            score = scaledScore;
+            scale = k;
+            // Back into smallRegion through the scaling of the area
+            double scaleX = (double) area.width / scaledSize.width;
+            double scaleY = (double) area.height / scaledSize.height;
+            center = cv::Point2f((float) (area.x + (loc.x + (templateSize.width - 1) / 2.0 + 0.5) * scaleX - 0.5),
+                                 (float) (area.y + (loc.y + (templateSize.height - 1) / 2.0 + 0.5) * scaleY - 0.5));
+            found = true;
+        }
+    }
+    return found;
 }
 
 void TemplateTrackingModule::drawOnFrame(cv::Mat &frame, Point point)
 {
 #ifdef DEBUGING
-    int width = fullTemplateSize.width;
-    int height = fullTemplateSize.height;
+    // frame may be a downscaled preview
+    double scale = (double) frame.size().width / fullImageSize.width;
+    int width = (int) (fullTemplateSize.width * scale);
+    int height = (int) (fullTemplateSize.height * scale);
     cv::Rect rectangle(point.X() - width / 2, point.Y() - height / 2, width, height);
     ImageProcessing::drawGreenRectangle(frame, rectangle);
 #else
@@ -137,57 +350,83 @@ cv::Point TemplateTrackingModule::adjustPoint(cv::Point point, cv::Size limits)
     return cv::Point(x, y);
 }
 
-cv::Mat TemplateTrackingModule::workingFrame(cv::Mat &frame)
+// Downscales only the given region of the frame
+cv::Mat TemplateTrackingModule::workingRegion(cv::Mat &frame, cv::Rect region, cv::Size maxRegionSize)
 {
-    cv::Mat resizedFrame;
-    scaleFactor = (float) workingWidth / frame.size().width;
-    cv::resize(frame, resizedFrame, cv::Size(), scaleFactor, scaleFactor);
-    return resizedFrame;
+    cv::Size size = workingSize(region.size());
+    cv::Mat resizedRegion = poolView(BUFFER_WORKING_FRAME, size, workingSize(maxRegionSize), frame.type());
+    cv::resize(frame(region), resizedRegion, size);
+    return resizedRegion;
 }
 
-cv::Point TemplateTrackingModule::match(cv::Mat &frame, cv::Mat &tmpl, cv::Size limits, cv::Point searchCenter, cv::Size searchSize)
+cv::Size TemplateTrackingModule::workingSize(cv::Size size)
+{
+    return cv::Size(cvRound(size.width * (double) scaleFactor), cvRound(size.height * (double) scaleFactor));
+}
+
+// Part of a pool buffer allocated for maxSize, so that regions clipped at the
+// frame border reuse it as well
+cv::Mat TemplateTrackingModule::poolView(PoolBuffer id, cv::Size size, cv::Size maxSize, int type)
+{
+    cv::Mat &buffer = bufferPool->get(id, maxSize, type);
+    return buffer(cv::Rect(0, 0, size.width, size.height));
+}
+
+// The image templates are matched on: a grey copy when matching in grey,
+// otherwise the image itself
+cv::Mat TemplateTrackingModule::matchingImage(const cv::Mat &image, PoolBuffer id, cv::Size maxSize)
+{
+    if (!greyMatching || image.channels() == 1)
+        return image;
+    cv::Mat grey = poolView(id, image.size(), maxSize, CV_8UC1);
+    ASM::convertToGray(image, grey);
+    return grey;
+}
+
+// Templates are kept (copied) in the type they are matched in
+void TemplateTrackingModule::storeTemplate(const cv::Mat &patch, cv::Mat &tmpl)
+{
+    if (greyMatching)
+        ASM::convertToGray(patch, tmpl);
+    else
+        patch.copyTo(tmpl);
+}
+
+// Region of searchSize centered in searchCenter, clipped to the frame
+cv::Rect TemplateTrackingModule::searchRegion(cv::Point searchCenter, cv::Size searchSize, cv::Size frameSize)
 {
-    // Adjust search region
     int offX = (2 * searchCenter.x - searchSize.width) / 2; // Subtracting first may change the result
     int offY = (2 * searchCenter.y - searchSize.height) / 2; // Subtracting first may change the result
     if (offX < 0) offX = 0;
     if (offY < 0) offY = 0;
     int searchWidth = searchSize.width;
     int searchHeight = searchSize.height;
-    if (offX + searchWidth > frame.size().width) searchWidth = frame.size().width - offX;
-    if (offY + searchHeight > frame.size().height) searchHeight = frame.size().height - offY;
-    if (searchWidth < tmpl.size().width || searchHeight < tmpl.size().height) // Search area is smaller than template
+    if (offX + searchWidth > frameSize.width) searchWidth = frameSize.width - offX;
+    if (offY + searchHeight > frameSize.height) searchHeight = frameSize.height - offY;
+    return cv::Rect(offX, offY, searchWidth, searchHeight);
+}
+
+cv::Point TemplateTrackingModule::match(cv::Mat &frame, cv::Mat &tmpl, cv::Size limits, cv::Point searchCenter, cv::Size searchSize, cv::Point expected, PoolBuffer resultBuffer)
+{
+    // Adjust search region
+    cv::Rect region = searchRegion(searchCenter, searchSize, frame.size());
+    int offX = region.x;
+    int offY = region.y;
+    if (region.width < tmpl.size().width || region.height < tmpl.size().height) // Search area is smaller than template
     {
         return searchCenter;
     }
-    cv::Mat searchRegion(frame(cv::Rect(offX, offY, searchWidth, searchHeight)));
-
-    int resultCols =  searchRegion.cols - tmpl.cols + 1;
-    int resultRows = searchRegion.rows - tmpl.rows + 1;
-    cv::Mat result(resultRows, resultCols, CV_32FC1);
-
-    // Do the Matching and Normalize
-    int match_method = CV_TM_SQDIFF;
-    cv::matchTemplate(searchRegion, tmpl, result, match_method);
-    cv::normalize(result, result, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-
-    // Localizing the best match with minMaxLoc
-    double minVal;
-    double maxVal;
-    cv::Point minLoc;
-    cv::Point maxLoc;
-    cv::Point matchLoc;
-
-    cv::minMaxLoc(result, &minVal, &maxVal, &minLoc, &maxLoc, cv::Mat());
-    // For SQDIFF and SQDIFF_NORMED, the best matches are lower values. For all the other methods, the higher the better
-    if( match_method  == CV_TM_SQDIFF || match_method == CV_TM_SQDIFF_NORMED )
-    {
-        matchLoc = minLoc;
-    }
-    else
+    cv::Mat searchArea(frame(region));
+
+    // Best match of the template, starting from where it is expected to be
+    cv::Mat result;
+    if (matchKernel == SSD_OPENCV)
     {
-        matchLoc = maxLoc;
+        int resultCols =  searchArea.cols - tmpl.cols + 1;
+        int resultRows = searchArea.rows - tmpl.rows + 1;
+        result = bufferPool->get(resultBuffer, cv::Size(resultCols, resultRows), CV_32FC1);
     }
+    cv::Point matchLoc = SsdMatcher::findBest(searchArea, tmpl, matchKernel, result, expected - cv::Point(offX, offY));
     return adjustPoint(matchLoc + cv::Point(offX, offY), limits);
 }
 
@@ -18,6 +18,7 @@
 #ifndef CMS_TEMPLATETRACKINGMODULE_H
 #define CMS_TEMPLATETRACKINGMODULE_H
 
+#include "SsdMatcher.h"
 #include "TrackingModule.h"
 
 namespace CMS {
@@ -25,16 +26,37 @@ namespace CMS {
 class TemplateTrackingModule : public ITrackingModule
 {
 public:
-    TemplateTrackingModule(double templateSizeRatio);
-    Point track(cv::Mat &frame);
+    // Matching on grey images reads a quarter of the bytes of BGRA frames. Colour
+    // stays the default until grey matching is shown to track as accurately.
+    TemplateTrackingModule(double templateSizeRatio, bool greyMatching = false);
+    TrackResult track(cv::Mat &frame);
     void setTrackPoint(cv::Mat &frame, Point point);
     void drawOnFrame(cv::Mat &frame, Point point);
     cv::Size getImageSize();
     bool isInitialized();
+    void setMatchKernel(SsdKernel kernel);
+    SsdKernel getMatchKernel();
+    // Refines matches below pixel precision and skips the full resolution pass
+    // when the coarse match is sharp enough on its own
+    void setSubPixelRefinement(bool enabled);
+    // Also matches the template slightly larger and smaller than the feature
+    // was, and follows the feature as it changes size (the user leaning in or back)
+    void setScaleAdaptation(bool enabled);
 
 private:
+    static const double MIN_PEAK_SHARPNESS;
+    static const double DEGRADED_SCORE_RATIO;
+    static const double SCORE_SMOOTHING;
+    static const double WIDEN_FACTOR;
+    static const int MIN_SEARCH_MARGIN = 8;
+    static const double SCALE_STEP;
+    static const double SCALE_SWITCH_RATIO;
+    static const double MIN_FEATURE_SCALE;
+    static const double MAX_FEATURE_SCALE;
+
     TrackingModuleSanityCheck sanityCheck;
     bool initialized;
+    bool greyMatching;
     int workingWidth;
     cv::Size imageSize;
     cv::Size fullImageSize;
@@ -43,15 +65,29 @@ private:
     cv::Size fullTemplateSize;
     cv::Mat templ;
     cv::Mat fullTempl;
-    cv::Mat result;
-    cv::Mat fullResult;
     float scaleFactor;
     Point prevLoc;
+    SsdKernel matchKernel;
+    bool subPixelRefinement;
+    bool scaleAdaptation;
+    double featureScale; // Size of the feature relative to when the track point was set
+    double typicalScore; // Running average of the coarse match score, negative until the first match
 
     int adjustPosition(int pos, int limit);
     cv::Point adjustPoint(cv::Point point, cv::Size limits);
-    cv::Mat workingFrame(cv::Mat &frame);
-    cv::Point match(cv::Mat &frame, cv::Mat &tmpl, cv::Size limits, cv::Point searchCenter, cv::Size searchSize);
+    cv::Mat workingRegion(cv::Mat &frame, cv::Rect region, cv::Size maxRegionSize);
+    cv::Size workingSize(cv::Size size);
+    cv::Mat poolView(PoolBuffer id, cv::Size size, cv::Size maxSize, int type);
+    cv::Mat matchingImage(const cv::Mat &image, PoolBuffer id, cv::Size maxSize);
+    void storeTemplate(const cv::Mat &patch, cv::Mat &tmpl);
+    void updateTemplateSizes(cv::Size frameSize);
+    void extractTemplates(cv::Mat &frame, Point point);
+    bool matchScales(cv::Mat &smallRegion, cv::Point matchLoc, double &score, double &scale, cv::Point2f &center);
+    cv::Point coarseMatch(cv::Mat &frame, Point center, cv::Size searchSize, cv::Size maxSearchSize, cv::Rect &region, cv::Mat &smallRegion);
+    cv::Size predictedSearchSize(cv::Size maxSearchSize);
+    double matchConfidence(double score);
+    cv::Rect searchRegion(cv::Point searchCenter, cv::Size searchSize, cv::Size frameSize);
+    cv::Point match(cv::Mat &frame, cv::Mat &tmpl, cv::Size limits, cv::Point searchCenter, cv::Size searchSize, cv::Point expected, PoolBuffer resultBuffer);
 };
 
 } // namespace CMS
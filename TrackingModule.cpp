@@ -22,9 +22,31 @@
 
 namespace CMS {
 
+TrackResult::TrackResult() :
+    subPixel(false),
+    confidence(0),
+    lost(true)
+{}
+
+TrackResult::TrackResult(Point position, bool subPixel, double confidence) :
+    position(position),
+    subPixel(subPixel),
+    confidence(position.empty() ? 0 : confidence),
+    lost(position.empty())
+{}
+
+ITrackingModule::ITrackingModule() :
+    bufferPool(&ownBufferPool)
+{}
+
 ITrackingModule::~ITrackingModule()
 {}
 
+void ITrackingModule::setBufferPool(FrameBufferPool *bufferPool)
+{
+    this->bufferPool = bufferPool;
+}
+
 void ITrackingModule::drawOnFrame(cv::Mat &frame, Point point)
 {
     float ratio = 0.03;
@@ -64,7 +86,7 @@ void TrackingModuleSanityCheck::limitTPDelta(cv::Point2f &cur, cv::Point2f &last
     double difX = cur.x - last.x;
     double difY = cur.y - last.y;
     double dist = difX * difX + difY * difY;
-    if (dist > 35*35)
+    if (dist > MAX_TP_DELTA * MAX_TP_DELTA)
     {
         cur.x = last.x;
         cur.y = last.y;
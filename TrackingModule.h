@@ -20,19 +20,43 @@
 
 #include <cv.h>
 
+#include "FrameBufferPool.h"
+#include "MotionPredictor.h"
 #include "Point.h"
 
 namespace CMS {
 
+// Outcome of tracking the feature on one frame
+struct TrackResult
+{
+    TrackResult();
+    explicit TrackResult(Point position, bool subPixel = false, double confidence = 1);
+
+    Point position;     // Frame coordinates, empty if the feature was not found
+    bool subPixel;      // Whether position has sub-pixel precision
+    double confidence;  // How much the tracker trusts position, from 0 (not at all) to 1
+    bool lost;          // The feature was not found, position is empty
+};
+
 class ITrackingModule
 {
 public:
+    ITrackingModule();
     virtual ~ITrackingModule();
-    virtual Point track(cv::Mat &frame) = 0;
+    virtual TrackResult track(cv::Mat &frame) = 0;
     virtual void setTrackPoint(cv::Mat &frame, Point point) = 0;
     virtual void drawOnFrame(cv::Mat &frame, Point point);
     virtual cv::Size getImageSize() = 0;
     virtual bool isInitialized() = 0;
+    void setBufferPool(FrameBufferPool *bufferPool);
+
+protected:
+    FrameBufferPool *bufferPool;
+    // Where the feature is expected on the next frame, from its motion so far
+    MotionPredictor predictor;
+
+private:
+    FrameBufferPool ownBufferPool; // Used until the pipeline provides its own
 };
 
 class TrackingModuleSanityCheck
@@ -44,6 +68,9 @@ public:
     void checkFrameSize(cv::Mat &frame);
     void limitTPDelta(cv::Point2f &cur, cv::Point2f &last);
 
+    // Largest movement of the track point accepted between two frames, in pixels
+    static const int MAX_TP_DELTA = 35;
+
 private:
     ITrackingModule *trackingModule;
 };
@@ -0,0 +1,232 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cmath>
+#include <stdexcept>
+
+#include "TrackingModuleRegistry.h"
+#include "MosseTrackingModule.h"
+#include "StandardTrackingModule.h"
+#include "TemplateTrackingModule.h"
+
+namespace CMS {
+
+static SsdKernel kernelByName(const QString &name)
+{
+    for (int kernel = 0; kernel < SSD_KERNEL_COUNT; kernel++)
+    {
+        if (name == SsdMatcher::kernelName((SsdKernel) kernel))
+        {
+            if (!SsdMatcher::isSupported((SsdKernel) kernel))
+                throw std::invalid_argument("SSD kernel not supported on this CPU: " + name.toStdString());
+            return (SsdKernel) kernel;
+        }
+    }
+    throw std::invalid_argument("Unknown SSD kernel: " + name.toStdString());
+}
+
+static ParameterRange range(double minimum, double maximum)
+{
+    ParameterRange result = {minimum, maximum};
+    return result;
+}
+
+// QVariant turns any non-empty string into true, only these are accepted
+static bool parseBool(const QVariant &value, bool &ok)
+{
+    ok = true;
+    if (value.userType() == QMetaType::Bool)
+        return value.toBool();
+    QString text = value.toString().trimmed().toLower();
+    if (text == "true" || text == "1")
+        return true;
+    if (text == "false" || text == "0")
+        return false;
+    ok = false;
+    return false;
+}
+
+static ITrackingModule *newTemplateTracker(const TrackerParameters &parameters)
+{
+    SsdKernel kernel = kernelByName(parameters.value("kernel").toString());
+    TemplateTrackingModule *module = new TemplateTrackingModule(parameters.value("template-size").toDouble(),
+                                                                parameters.value("grey").toBool());
+    module->setMatchKernel(kernel);
+    module->setSubPixelRefinement(parameters.value("sub-pixel").toBool());
+    module->setScaleAdaptation(parameters.value("multi-scale").toBool());
+    return module;
+}
+
+static ITrackingModule *newLucasKanadeTracker(const TrackerParameters &)
+{
+    return new StandardTrackingModule(LK_SINGLE_POINT);
+}
+
+static ITrackingModule *newMedianFlowTracker(const TrackerParameters &)
+{
+    return new StandardTrackingModule(LK_MEDIAN_FLOW);
+}
+
+static ITrackingModule *newMosseTracker(const TrackerParameters &parameters)
+{
+    return new MosseTrackingModule(parameters.value("patch-size").toDouble(), CORRELATION_LINEAR,
+                                   parameters.value("learning-rate").toDouble());
+}
+
+static ITrackingModule *newKcfTracker(const TrackerParameters &parameters)
+{
+    return new MosseTrackingModule(parameters.value("patch-size").toDouble(), CORRELATION_GAUSSIAN,
+                                   parameters.value("learning-rate").toDouble());
+}
+
+TrackingModuleRegistry &TrackingModuleRegistry::instance()
+{
+    static TrackingModuleRegistry registry;
+    return registry;
+}
+
+TrackingModuleRegistry::TrackingModuleRegistry()
+{
+    TrackerParameters templateDefaults;
+    templateDefaults["template-size"] = 0.08; // Relative to the frame width
+    templateDefaults["grey"] = false;
+    templateDefaults["kernel"] = QString("auto");
+    templateDefaults["sub-pixel"] = false;
+    templateDefaults["multi-scale"] = false;
+    ParameterRanges templateRanges;
+    templateRanges["template-size"] = range(0.01, 0.5);
+    add("template", "Template matching", newTemplateTracker, templateDefaults, templateRanges);
+    add("lk", "Lucas-Kanade optical flow of the feature point", newLucasKanadeTracker);
+    add("median-flow", "Median Lucas-Kanade flow of points around the feature", newMedianFlowTracker);
+
+    TrackerParameters correlationDefaults;
+    correlationDefaults["patch-size"] = 0.125; // Relative to the frame width
+    correlationDefaults["learning-rate"] = 0.125;
+    ParameterRanges correlationRanges;
+    correlationRanges["patch-size"] = range(0.02, 0.5);
+    correlationRanges["learning-rate"] = range(0.001, 1);
+    add("mosse", "MOSSE correlation filter", newMosseTracker, correlationDefaults, correlationRanges);
+    correlationDefaults["learning-rate"] = 0.075;
+    add("kcf", "Gaussian kernel correlation filter (KCF)", newKcfTracker, correlationDefaults, correlationRanges);
+}
+
+void TrackingModuleRegistry::add(const QString &name, const QString &description, TrackerFactory factory,
+                                 const TrackerParameters &defaults, const ParameterRanges &ranges)
+{
+    if (contains(name))
+        throw std::invalid_argument("Tracker already registered: " + name.toStdString());
+    Entry entry;
+    entry.name = name;
+    entry.description = description;
+    entry.factory = factory;
+    entry.defaults = defaults;
+    entry.ranges = ranges;
+    entries.push_back(entry);
+}
+
+QStringList TrackingModuleRegistry::getNames()
+{
+    QStringList names;
+    for (size_t i = 0; i < entries.size(); i++)
+        names << entries[i].name;
+    return names;
+}
+
+bool TrackingModuleRegistry::contains(const QString &name)
+{
+    return getNames().contains(name);
+}
+
+QString TrackingModuleRegistry::getDescription(const QString &name)
+{
+    return find(name).description;
+}
+
+TrackerParameters TrackingModuleRegistry::getDefaults(const QString &name)
+{
+    return find(name).defaults;
+}
+
+TrackerParameters TrackingModuleRegistry::parseParameters(const QString &name, const QStringList &assignments)
+{
+    TrackerParameters parameters;
+    foreach (const QString &assignment, assignments)
+    {
+        int separator = assignment.indexOf('=');
+        if (separator < 0)
+            throw std::invalid_argument("Tracker parameter is not key=value: " + assignment.toStdString());
+        parameters[assignment.left(separator)] = assignment.mid(separator + 1);
+    }
+    return merge(find(name), parameters);
+}
+
+ITrackingModule *TrackingModuleRegistry::create(const QString &name, const TrackerParameters &parameters)
+{
+    const Entry &entry = find(name);
+    return entry.factory(merge(entry, parameters));
+}
+
+const TrackingModuleRegistry::Entry &TrackingModuleRegistry::find(const QString &name)
+{
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].name == name)
+            return entries[i];
+    }
+    throw std::invalid_argument("Unknown tracker: " + name.toStdString());
+}
+
+// Values are converted to the type of the default, so that strings from the
+// command line can be given for any parameter
+TrackerParameters TrackingModuleRegistry::merge(const Entry &entry, const TrackerParameters &parameters)
+{
+    TrackerParameters merged = entry.defaults;
+    for (TrackerParameters::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+    {
+        const QString &key = it.key();
+        if (!entry.defaults.contains(key))
+            throw std::invalid_argument("Unknown parameter of tracker " + entry.name.toStdString() + ": " + key.toStdString());
+        std::string invalid = "Invalid value of tracker parameter " + key.toStdString() + ": " +
+                it.value().toString().toStdString();
+        QVariant value = it.value();
+        int type = entry.defaults[key].userType();
+        if (type == QMetaType::Bool)
+        {
+            bool ok;
+            value = parseBool(it.value(), ok);
+            if (!ok)
+                throw std::invalid_argument(invalid + " (expected true, false, 1 or 0)");
+        }
+        else if (!value.convert(type))
+        {
+            throw std::invalid_argument(invalid);
+        }
+        if (entry.ranges.contains(key))
+        {
+            const ParameterRange &range = entry.ranges[key];
+            double number = value.toDouble();
+            if (!std::isfinite(number) || number < range.minimum || number > range.maximum)
+                throw std::invalid_argument(invalid + " (expected " + QString::number(range.minimum).toStdString() +
+                                            " to " + QString::number(range.maximum).toStdString() + ")");
+        }
+        merged[key] = value;
+    }
+    return merged;
+}
+
+} // namespace CMS
@@ -0,0 +1,86 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CMS_TRACKINGMODULEREGISTRY_H
+#define CMS_TRACKINGMODULEREGISTRY_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <vector>
+
+#include "TrackingModule.h"
+
+namespace CMS {
+
+// Parameters of a tracker by name; the defaults given when it is registered
+// also fix the type of each value
+typedef QVariantMap TrackerParameters;
+typedef ITrackingModule *(*TrackerFactory)(const TrackerParameters &parameters);
+
+// Allowed values of a numeric parameter, both ends included
+struct ParameterRange
+{
+    double minimum;
+    double maximum;
+};
+typedef QMap<QString, ParameterRange> ParameterRanges;
+
+// Tracking modules that can be chosen at run time by name. The built-in
+// trackers are registered when the registry is first used.
+class TrackingModuleRegistry
+{
+public:
+    static TrackingModuleRegistry &instance();
+
+    void add(const QString &name, const QString &description, TrackerFactory factory,
+             const TrackerParameters &defaults = TrackerParameters(),
+             const ParameterRanges &ranges = ParameterRanges());
+    QStringList getNames(); // In the order they were added
+    bool contains(const QString &name);
+    QString getDescription(const QString &name);
+    TrackerParameters getDefaults(const QString &name);
+    // The defaults of the tracker with "key=value" assignments applied
+    TrackerParameters parseParameters(const QString &name, const QStringList &assignments);
+    // Parameters not given keep their defaults. Unknown trackers, unknown
+    // parameters, values of the wrong type and numbers out of range throw
+    // std::invalid_argument.
+    ITrackingModule *create(const QString &name, const TrackerParameters &parameters = TrackerParameters());
+
+private:
+    struct Entry
+    {
+        QString name;
+        QString description;
+        TrackerFactory factory;
+        TrackerParameters defaults;
+        ParameterRanges ranges;
+    };
+    std::vector<Entry> entries;
+
+    TrackingModuleRegistry();
+    TrackingModuleRegistry(const TrackingModuleRegistry&);
+    TrackingModuleRegistry& operator=(const TrackingModuleRegistry&);
+    const Entry &find(const QString &name);
+    TrackerParameters merge(const Entry &entry, const TrackerParameters &parameters);
+};
+
+} // namespace CMS
+
+#endif // CMS_TRACKINGMODULEREGISTRY_H
@@ -0,0 +1,128 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrackingThread.h"
+#include "FrameConverter.h"
+#include "Profiler.h"
+#include "Point.h"
+
+namespace CMS {
+
+TrackingThread::TrackingThread(Settings &settings, CameraMouseController *controller, QObject *parent) :
+    QThread(parent),
+    settings(settings),
+    controller(controller),
+    running(true),
+    processedFrames(0)
+{
+}
+
+void TrackingThread::post(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime)
+{
+    mailbox.post(mailbox.acquire(videoFrame, previewSize, captureTime));
+    // The lock only makes sure the wake up is not lost, posting never waits for processing
+    wakeMutex.lock();
+    frameAvailable.wakeOne();
+    wakeMutex.unlock();
+}
+
+void TrackingThread::stop()
+{
+    wakeMutex.lock();
+    running = false;
+    frameAvailable.wakeOne();
+    wakeMutex.unlock();
+}
+
+int TrackingThread::getDroppedFrames()
+{
+    return mailbox.getDroppedFrames();
+}
+
+int TrackingThread::getProcessedFrames()
+{
+    return processedFrames.load();
+}
+
+void TrackingThread::run()
+{
+    CapturedFrame *frame;
+    while ((frame = waitForFrame()))
+    {
+        process(frame);
+        mailbox.recycle(frame);
+        processedFrames++;
+    }
+}
+
+CapturedFrame *TrackingThread::waitForFrame()
+{
+    QMutexLocker locker(&wakeMutex);
+    while (running)
+    {
+        CapturedFrame *frame = mailbox.take();
+        if (frame)
+            return frame;
+        frameAvailable.wait(&wakeMutex);
+    }
+    return 0;
+}
+
+void TrackingThread::process(CapturedFrame *frame)
+{
+    QVideoFrame &videoFrame = frame->videoFrame;
+    if (!videoFrame.map(QAbstractVideoBuffer::ReadOnly))
+        return;
+
+    // No copies: the trackers work directly on the camera buffer and
+    // mirroring is handled by the controller as a coordinate transform
+    FrameBufferPool &bufferPool = controller->getBufferPool();
+    bufferPool.beginFrame();
+    cv::Mat mat;
+    {
+        ScopedStageTimer timer(STAGE_CONVERSION);
+        mat = FrameConverter::wrap(videoFrame, bufferPool);
+    }
+
+    if (settings.getFrameSize().empty())
+        settings.setFrameSize(Point(mat.cols, mat.rows));
+
+    controller->processFrame(mat, frame->captureTime);
+
+    QSize previewSize = FrameConverter::previewSize(mat, frame->previewSize);
+    QImage preview;
+    if (!previewSize.isEmpty())
+    {
+        // The preview is written in place, a copy of it is handed to the GUI thread
+        QImage &previewImage = bufferPool.getImage(IMAGE_PREVIEW, previewSize, QImage::Format_RGB32);
+        cv::Mat previewMat(previewImage.height(), previewImage.width(), CV_8UC4, previewImage.bits(), previewImage.bytesPerLine());
+        {
+            ScopedStageTimer timer(STAGE_PREVIEW);
+            FrameConverter::preview(videoFrame, mat, previewMat, controller->getFrameFlip(), bufferPool);
+        }
+        controller->drawOnPreview(previewMat);
+        preview = previewImage;
+    }
+
+    // Release the data
+    videoFrame.unmap();
+
+    if (!preview.isNull())
+        emit frameProcessed(preview, QSize(mat.cols, mat.rows));
+}
+
+} // namespace CMS
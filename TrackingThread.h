@@ -0,0 +1,68 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_TRACKINGTHREAD_H
+#define CMS_TRACKINGTHREAD_H
+
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+
+#include "CameraMouseController.h"
+#include "FrameMailbox.h"
+#include "Settings.h"
+
+namespace CMS {
+
+// Runs the tracking pipeline on its own thread so that the camera is never
+// blocked by it. Only the newest captured frame is processed.
+class TrackingThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    TrackingThread(Settings &settings, CameraMouseController *controller, QObject *parent = 0);
+    void post(const QVideoFrame &videoFrame, QSize previewSize, qint64 captureTime);
+    void stop();
+    int getDroppedFrames();
+    int getProcessedFrames();
+
+signals:
+    void frameProcessed(QImage preview, QSize frameSize);
+
+protected:
+    void run();
+
+private:
+    Settings &settings;
+    CameraMouseController *controller;
+    FrameMailbox mailbox;
+    QMutex wakeMutex;
+    QWaitCondition frameAvailable;
+    bool running;
+    std::atomic<int> processedFrames;
+
+    CapturedFrame *waitForFrame();
+    void process(CapturedFrame *frame);
+};
+
+} // namespace CMS
+
+#endif // CMS_TRACKINGTHREAD_H
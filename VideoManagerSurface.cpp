@@ -20,29 +20,46 @@
 #include <QMouseEvent>
 
 #include "VideoManagerSurface.h"
-#include "asmOpenCV.h"
+#include "Clock.h"
+#include "FrameConverter.h"
+#include "FrameFlip.h"
 #include "Point.h"
-#include "TemplateTrackingModule.h"
+#include "Profiler.h"
 
 namespace CMS {
 
 VideoManagerSurface::VideoManagerSurface(Settings &settings, CameraMouseController *controller, QLabel *imageLabel, QObject *parent) :
     QAbstractVideoSurface(parent),
     settings(settings),
-    controller(controller)
+    controller(controller),
+    trackingThread(settings, controller)
 {
     this->imageLabel = imageLabel;
-    supportedFormats = QList<QVideoFrame::PixelFormat>() << QVideoFrame::Format_RGB24
-                                                         << QVideoFrame::Format_RGB32;
+    supportedFormats = FrameConverter::supportedFormats();
+    controller->setFrameFlip(FrameFlip::cameraMirroring());
     connect(imageLabel, SIGNAL(mousePressed(QMouseEvent*)), this, SLOT(mousePressEvent(QMouseEvent*)));
+    connect(&trackingThread, SIGNAL(frameProcessed(QImage,QSize)), this, SLOT(showFrame(QImage,QSize)), Qt::QueuedConnection);
+    trackingThread.start();
 }
 
 VideoManagerSurface::~VideoManagerSurface()
 {
+    trackingThread.stop();
+    trackingThread.wait();
     // TODO Move to MainWindow if we decide to keep the pointer there
     delete(controller);
 }
 
+int VideoManagerSurface::getProcessedFrames()
+{
+    return trackingThread.getProcessedFrames();
+}
+
+int VideoManagerSurface::getDroppedFrames()
+{
+    return trackingThread.getDroppedFrames();
+}
+
 QList<QVideoFrame::PixelFormat> VideoManagerSurface::supportedPixelFormats(QAbstractVideoBuffer::HandleType handleType) const
 {
     if (handleType == QAbstractVideoBuffer::NoHandle)
@@ -64,56 +81,29 @@ bool VideoManagerSurface::present(const QVideoFrame &frame)
     }
     else
     {
-        QVideoFrame frameToProcess(frame);
-
-        if(!frameToProcess.map(QAbstractVideoBuffer::ReadWrite))
-        {
-           setError(ResourceError);
-           return false;
-        }
-
-         // This is a shallow operation. it just refer the frame buffer
-        QImage image(
-                frameToProcess.bits(),
-                frameToProcess.width(),
-                frameToProcess.height(),
-                frameToProcess.bytesPerLine(),
-                QVideoFrame::imageFormatFromPixelFormat(frameToProcess.pixelFormat()));
-        // The kind of mirroring needed depends on the OS
-        #ifdef Q_OS_LINUX
-            image = image.mirrored(true, false);
-        #elif defined Q_OS_WIN
-            image = image.mirrored(true, true);
-        #elif defined Q_OS_MAC
-            image = image.mirrored(true, false);
-        #endif
-        cv::Mat mat = ASM::QImageToCvMat(image);
-
-        controller->processFrame(mat);
-
-        image = ASM::cvMatToQImage(mat);
-        QImage scaledImage = image.scaled(imageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
-        if (frameSize.isEmpty())
-        {
-            settings.setFrameSize(Point(image.size()));
-            frameSize = image.size();
-            scaledFrameSize = scaledImage.size();
-            frameOffset = Point(imageLabel->size().width() - scaledImage.width(), imageLabel->size().height() - scaledImage.height())/2;
-        }
-
-        // QPixmap::fromImage create a new buffer for the pixmap
-        imageLabel->setPixmap(QPixmap::fromImage(scaledImage));
-
-        // Release the data
-        frameToProcess.unmap();
-
-        imageLabel->update();
-
+        // Processing happens on the tracking thread, if it is still busy with
+        // the previous frame that one is replaced by this one
+        trackingThread.post(frame, imageLabel->size(), Clock::nowMicros());
         return true;
     }
 }
 
+void VideoManagerSurface::showFrame(QImage preview, QSize frameSize)
+{
+    ScopedStageTimer timer(STAGE_DISPLAY);
+
+    if (this->frameSize.isEmpty())
+    {
+        this->frameSize = frameSize;
+        scaledFrameSize = preview.size();
+        frameOffset = Point(imageLabel->size().width() - preview.width(), imageLabel->size().height() - preview.height())/2;
+    }
+
+    // QPixmap::fromImage create a new buffer for the pixmap
+    imageLabel->setPixmap(QPixmap::fromImage(preview));
+    imageLabel->update();
+}
+
 void VideoManagerSurface::mousePressEvent(QMouseEvent *event)
 {
     if (frameSize.isEmpty())
@@ -28,6 +28,7 @@
 #include "MouseControlModule.h"
 #include "Keyboard.h"
 #include "CameraMouseController.h"
+#include "TrackingThread.h"
 #include "Point.h"
 #include "Settings.h"
 
@@ -44,13 +45,18 @@ public:
     ~VideoManagerSurface();
     QList<QVideoFrame::PixelFormat> supportedPixelFormats(QAbstractVideoBuffer::HandleType handleType) const;
     bool present(const QVideoFrame &frame);
+    // Frames the tracking thread processed, and dropped for newer ones
+    int getProcessedFrames();
+    int getDroppedFrames();
 
 protected slots:
     void mousePressEvent(QMouseEvent *event);
+    void showFrame(QImage preview, QSize frameSize);
 
 private:
     Settings &settings;
     CameraMouseController *controller;
+    TrackingThread trackingThread;
     QLabel *imageLabel;
     QList<QVideoFrame::PixelFormat> supportedFormats;
     QSize frameSize;
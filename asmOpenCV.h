@@ -143,6 +143,27 @@ namespace ASM {
        }
        return gray;
    }
+
+   // Convert cv::Mat to gray, writing to gray (which is reused if it already has the right size)
+   inline void convertToGray(const cv::Mat &colorMat, cv::Mat &gray)
+   {
+       if (colorMat.type() == CV_8UC4)
+       {
+           cv::cvtColor(colorMat, gray, cv::COLOR_BGRA2GRAY);
+       }
+       else if (colorMat.type() == CV_8UC3)
+       {
+           cv::cvtColor(colorMat, gray, cv::COLOR_BGR2GRAY);
+       }
+       else if (colorMat.type() == CV_8UC1)
+       {
+           colorMat.copyTo(gray);
+       }
+       else
+       {
+           throw std::invalid_argument("cv::Mat type not supported");
+       }
+   }
 }
 
 #endif // __ASM_OPENCV_H__
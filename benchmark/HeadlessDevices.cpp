@@ -0,0 +1,105 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+
+#include "HeadlessDevices.h"
+
+namespace CMS {
+
+RecordingMouse::RecordingMouse(IMouse *target) :
+    target(target),
+    moveCount(0),
+    clickCount(0)
+{
+}
+
+RecordingMouse::~RecordingMouse()
+{
+    delete target;
+}
+
+void RecordingMouse::move(double x, double y)
+{
+    if (target)
+        target->move(x, y);
+    lastPosition = Point(x, y);
+    moveCount++;
+}
+
+void RecordingMouse::click()
+{
+    if (target)
+        target->click();
+    clickCount++;
+}
+
+void RecordingMouse::press()
+{
+    if (target)
+        target->press();
+}
+
+void RecordingMouse::release()
+{
+    if (target)
+        target->release();
+}
+
+bool RecordingMouse::hasMovedSince(int moveCount)
+{
+    return this->moveCount != moveCount;
+}
+
+int RecordingMouse::getMoveCount()
+{
+    return moveCount;
+}
+
+Point RecordingMouse::getLastPosition()
+{
+    return lastPosition;
+}
+
+int RecordingMouse::getClickCount()
+{
+    return clickCount;
+}
+
+void ScriptedKeyboard::push(KeyEvent event)
+{
+    events.push(event);
+}
+
+KeyEvent ScriptedKeyboard::nextEvent()
+{
+    if (!hasNextEvent())
+    {
+        throw std::logic_error("No events available");
+    }
+
+    KeyEvent event = events.front();
+    events.pop();
+    return event;
+}
+
+bool ScriptedKeyboard::hasNextEvent()
+{
+    return !events.empty();
+}
+
+} // namespace CMS
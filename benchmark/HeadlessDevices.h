@@ -0,0 +1,68 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CMS_HEADLESSDEVICES_H
+#define CMS_HEADLESSDEVICES_H
+
+#include <queue>
+#include <vector>
+
+#include "Mouse.h"
+#include "Keyboard.h"
+#include "Point.h"
+
+namespace CMS {
+
+// Stand-in for the system mouse that records what would have been done.
+// If a target is given (e.g. the system mouse under Xvfb) the calls are also
+// forwarded to it.
+class RecordingMouse : public IMouse
+{
+public:
+    explicit RecordingMouse(IMouse *target = 0);
+    ~RecordingMouse();
+    void move(double x, double y);
+    void click();
+    void press();
+    void release();
+    bool hasMovedSince(int moveCount);
+    int getMoveCount();
+    Point getLastPosition();
+    int getClickCount();
+
+private:
+    IMouse *target;
+    int moveCount;
+    Point lastPosition;
+    int clickCount;
+};
+
+// Stand-in for the system keyboard that replays a fixed list of events
+class ScriptedKeyboard : public IKeyboard
+{
+public:
+    void push(KeyEvent event);
+    KeyEvent nextEvent();
+    bool hasNextEvent();
+
+private:
+    std::queue<KeyEvent> events;
+};
+
+} // namespace CMS
+
+#endif // CMS_HEADLESSDEVICES_H
@@ -0,0 +1,618 @@
+/*                         Camera Mouse Suite
+ *  Copyright (C) 2015, Andrew Kurauchi
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Feeds a recorded video (or an image sequence such as frames/%04d.png) through
+// CameraMouseController::processFrame without a camera or a window and reports
+// how long each frame took together with the resulting pointer trajectory.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "CameraMouseController.h"
+#include "Clock.h"
+#include "FrameFlip.h"
+#include "MouseControlModule.h"
+#include "Profiler.h"
+#include "SsdMatcher.h"
+#include "TrackingModuleRegistry.h"
+#include "HeadlessDevices.h"
+#include "Settings.h"
+#include "Point.h"
+
+namespace {
+
+struct ReplayOptions
+{
+    QString input;
+    QStringList trackers;
+    QStringList trackerAssignments; // key=value, each applied to the trackers that have the key
+    CMS::Point screenResolution;
+    CMS::Point initialPoint;
+    bool autoDetect;
+    bool syncDetection;
+    bool fullFaceScan;
+    bool equalize;
+    bool mirror;
+    bool luma;
+    bool systemMouse;
+    int warmupFrames;
+    int maxFrames;
+    QString trajectoryFile;
+    QString profileFile;
+    QString referenceFile;
+};
+
+struct FrameRecord
+{
+    double millis;
+    CMS::Point pointer;
+    int allocations;
+    bool detection; // The feature detection ran while tracking
+};
+
+bool parsePair(QString text, CMS::Point &pair)
+{
+    QStringList parts = text.split(QRegExp("[x,]"));
+    if (parts.size() != 2)
+        return false;
+    bool okX, okY;
+    double x = parts[0].toDouble(&okX);
+    double y = parts[1].toDouble(&okY);
+    if (!okX || !okY)
+        return false;
+    pair = CMS::Point(x, y);
+    return true;
+}
+
+double percentile(std::vector<double> &sortedValues, double p)
+{
+    if (sortedValues.empty())
+        return 0;
+    size_t index = (size_t) (p / 100.0 * (sortedValues.size() - 1) + 0.5);
+    return sortedValues[index];
+}
+
+void setupSettings(CMS::Settings &settings, ReplayOptions &options)
+{
+    // Same defaults as the main window
+    settings.setEnableClicking(false);
+    settings.setDwellTime(1.0);
+    settings.setHorizontalGain(6);
+    settings.setVerticalGain(6);
+    settings.setEnableSmoothing(true);
+    settings.setDampingPercent(65);
+    settings.setAutoDetectNose(options.autoDetect);
+}
+
+// Camera frames arrive either as 32 bit RGB or as YUV, of which only the luma is tracked
+void convertFrame(ReplayOptions &options, cv::Mat &captured, cv::Mat &frame)
+{
+    if (options.luma)
+    {
+        if (captured.channels() == 1)
+            captured.copyTo(frame);
+        else
+            cv::cvtColor(captured, frame, captured.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+    else if (captured.channels() == 4)
+        captured.copyTo(frame);
+    else if (captured.channels() == 3)
+        cv::cvtColor(captured, frame, cv::COLOR_BGR2BGRA);
+    else
+        cv::cvtColor(captured, frame, cv::COLOR_GRAY2BGRA);
+}
+
+// Parameters of the tracker from the assignments whose key it has
+CMS::TrackerParameters trackerParameters(ReplayOptions &options, const QString &tracker)
+{
+    CMS::TrackerParameters defaults = CMS::TrackingModuleRegistry::instance().getDefaults(tracker);
+    QStringList assignments;
+    foreach (const QString &assignment, options.trackerAssignments)
+    {
+        if (defaults.contains(assignment.section('=', 0, 0)))
+            assignments << assignment;
+    }
+    return CMS::TrackingModuleRegistry::instance().parseParameters(tracker, assignments);
+}
+
+// Output file of one tracker when several are replayed, e.g. profile-lk.csv
+QString trackerFileName(ReplayOptions &options, const QString &fileName, const QString &tracker)
+{
+    if (options.trackers.size() == 1)
+        return fileName;
+    int extension = fileName.lastIndexOf('.');
+    if (extension <= fileName.lastIndexOf('/'))
+        return fileName + "-" + tracker;
+    return fileName.left(extension) + "-" + tracker + fileName.mid(extension);
+}
+
+bool replay(ReplayOptions &options, const QString &tracker, std::vector<FrameRecord> &records, QString &latency, QString &detectionPool)
+{
+    cv::VideoCapture capture(options.input.toStdString());
+    if (!capture.isOpened())
+        return false;
+
+    CMS::Settings settings(options.screenResolution);
+    setupSettings(settings, options);
+
+    CMS::RecordingMouse *mouse = new CMS::RecordingMouse(options.systemMouse ? CMS::MouseFactory::newMouse() : 0);
+    CMS::ScriptedKeyboard *keyboard = new CMS::ScriptedKeyboard;
+    // Pressing control once turns on mouse control
+    keyboard->push(CMS::KeyEvent(CMS::KEY_CONTROL, CMS::KEY_STATE_DOWN));
+
+    CMS::ITrackingModule *trackingModule = CMS::TrackingModuleRegistry::instance().create(tracker, trackerParameters(options, tracker));
+    CMS::MouseControlModule *controlModule = new CMS::MouseControlModule(settings, mouse, keyboard);
+    CMS::CameraMouseController controller(settings, trackingModule, controlModule);
+    if (options.mirror)
+        controller.setFrameFlip(CMS::FrameFlip(true, false));
+    controller.setAsynchronousDetection(!options.syncDetection);
+    controller.setLocalFaceSearch(!options.fullFaceScan);
+    controller.setHistogramEqualization(options.equalize);
+
+    cv::Mat captured;
+    cv::Mat frame;
+    QElapsedTimer timer;
+    int frameCount = 0;
+    int warmupDetectionAllocations = 0;
+    int warmupDetectionsWithAllocations = 0;
+    while ((options.maxFrames <= 0 || frameCount < options.maxFrames) && capture.read(captured))
+    {
+        qint64 captureTime = CMS::Clock::nowMicros();
+        if (frameCount == options.warmupFrames)
+        {
+            controller.getLatencyHistogram().reset();
+            CMS::Profiler::instance().reset();
+            controller.getDetectionPoolAllocations(warmupDetectionAllocations, warmupDetectionsWithAllocations);
+        }
+
+        convertFrame(options, captured, frame);
+
+        if (frameCount == 0)
+            settings.setFrameSize(CMS::Point(frame.cols, frame.rows));
+
+        int moveCount = mouse->getMoveCount();
+        int detectionCount = controller.getDetectionScheduler().getDetectionCount();
+        controller.getBufferPool().beginFrame();
+        timer.start();
+        controller.processFrame(frame, captureTime);
+        qint64 elapsed = timer.nsecsElapsed();
+
+        if (frameCount == 0 && !options.initialPoint.empty())
+            controller.processClick(options.initialPoint);
+
+        FrameRecord record;
+        record.millis = elapsed / 1e6;
+        record.allocations = controller.getBufferPool().getFrameAllocations();
+        record.detection = controller.getDetectionScheduler().getDetectionCount() != detectionCount;
+        if (mouse->hasMovedSince(moveCount))
+            record.pointer = mouse->getLastPosition();
+        records.push_back(record);
+        frameCount++;
+    }
+    latency = controller.getLatencyHistogram().summary();
+    int detectionAllocations, detectionsWithAllocations;
+    controller.getDetectionPoolAllocations(detectionAllocations, detectionsWithAllocations);
+    detectionPool = QString("%1 buffer allocations in %2 detections")
+            .arg(detectionAllocations - warmupDetectionAllocations)
+            .arg(detectionsWithAllocations - warmupDetectionsWithAllocations);
+    return true;
+}
+
+// Times each SSD kernel on the coarse search the template tracker does: a template
+// at the working width taken around the feature on one frame, searched for in a
+// third of the next frame. Positions are compared with the scalar kernel.
+bool benchmarkKernels(ReplayOptions &options, QTextStream &out)
+{
+    cv::VideoCapture capture(options.input.toStdString());
+    if (!capture.isOpened())
+        return false;
+
+    std::vector<cv::Mat> frames;
+    cv::Mat captured;
+    cv::Mat frame;
+    while ((options.maxFrames <= 0 || (int) frames.size() < options.maxFrames) && capture.read(captured))
+    {
+        convertFrame(options, captured, frame);
+        cv::Mat small;
+        double scale = 640.0 / frame.cols;
+        cv::resize(frame, small, cv::Size(), scale, scale);
+        frames.push_back(small);
+    }
+    if (frames.size() < 2)
+        return true;
+
+    cv::Size frameSize = frames[0].size();
+    cv::Point center(frameSize.width / 2, frameSize.height / 2);
+    if (!options.initialPoint.empty())
+        center = cv::Point(cvRound(options.initialPoint.X() * frameSize.width / frame.cols),
+                           cvRound(options.initialPoint.Y() * frameSize.height / frame.rows));
+    int side = cvRound(640 * 0.08);
+    cv::Rect templateRect = cv::Rect(center.x - side / 2, center.y - side / 2, side, side) &
+            cv::Rect(cv::Point(0, 0), frameSize);
+    cv::Size searchSize(frameSize.width / 3, frameSize.height / 3);
+    cv::Rect searchRect = cv::Rect(center.x - searchSize.width / 2, center.y - searchSize.height / 2,
+                                   searchSize.width, searchSize.height) & cv::Rect(cv::Point(0, 0), frameSize);
+    cv::Point expected = templateRect.tl() - searchRect.tl();
+
+    std::vector<cv::Point> reference;
+    cv::Mat result;
+    for (size_t i = 1; i < frames.size(); i++)
+        reference.push_back(CMS::SsdMatcher::findBest(frames[i](searchRect), frames[i - 1](templateRect), CMS::SSD_SCALAR, result, expected));
+
+    out << "Kernel benchmark: " << templateRect.width << "x" << templateRect.height << " template in "
+        << searchRect.width << "x" << searchRect.height << ", " << reference.size() << " searches\n";
+    QElapsedTimer timer;
+    for (int kernel = CMS::SSD_OPENCV; kernel < CMS::SSD_KERNEL_COUNT; kernel++)
+    {
+        if (!CMS::SsdMatcher::isSupported((CMS::SsdKernel) kernel))
+            continue;
+        int agreements = 0;
+        timer.start();
+        for (size_t i = 1; i < frames.size(); i++)
+        {
+            cv::Point loc = CMS::SsdMatcher::findBest(frames[i](searchRect), frames[i - 1](templateRect), (CMS::SsdKernel) kernel, result, expected);
+            if (loc == reference[i - 1])
+                agreements++;
+        }
+        double millis = timer.nsecsElapsed() / 1e6 / reference.size();
+        out << "  " << QString(CMS::SsdMatcher::kernelName((CMS::SsdKernel) kernel)).leftJustified(8)
+            << millis << " ms per search, " << agreements << "/" << reference.size() << " agree with scalar\n";
+    }
+    return true;
+}
+
+void report(ReplayOptions &options, std::vector<FrameRecord> &records, QTextStream &out)
+{
+    std::vector<double> millis;
+    double total = 0;
+    int allocations = 0;
+    int framesWithAllocations = 0;
+    int detections = 0;
+    for (size_t i = options.warmupFrames; i < records.size(); i++)
+    {
+        millis.push_back(records[i].millis);
+        total += records[i].millis;
+        allocations += records[i].allocations;
+        if (records[i].allocations > 0)
+            framesWithAllocations++;
+        if (records[i].detection)
+            detections++;
+    }
+    std::sort(millis.begin(), millis.end());
+
+    out << "Frames:      " << millis.size() << " (" << records.size() << " read, "
+        << options.warmupFrames << " warm-up)\n";
+    if (millis.empty())
+        return;
+    out << "Total:       " << total << " ms\n";
+    out << "Throughput:  " << 1000.0 * millis.size() / total << " frames/s\n";
+    out << "Per frame:   mean " << total / millis.size()
+        << " ms, p50 " << percentile(millis, 50)
+        << " ms, p90 " << percentile(millis, 90)
+        << " ms, p99 " << percentile(millis, 99)
+        << " ms, max " << millis.back() << " ms\n";
+    out << "Pool:        " << allocations << " buffer allocations in "
+        << framesWithAllocations << " frames\n";
+    out << "Detections:  " << detections << " while tracking\n";
+}
+
+void reportStages(QTextStream &out)
+{
+    out << "Stages:\n";
+    for (int stage = 0; stage < CMS::STAGE_COUNT; stage++)
+    {
+        CMS::StageStatistics statistics = CMS::Profiler::instance().getStatistics((CMS::ProfileStage) stage);
+        if (statistics.samples == 0)
+            continue;
+        out << "  " << QString(CMS::Profiler::stageName((CMS::ProfileStage) stage)).leftJustified(15)
+            << "min " << statistics.minMillis
+            << " ms, mean " << statistics.meanMillis
+            << " ms, p99 " << statistics.p99Millis
+            << " ms (" << statistics.samples << " samples)\n";
+    }
+}
+
+bool writeProfile(QString fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    CMS::Profiler::instance().writeCsv(out);
+    return true;
+}
+
+// Pointer positions of a CSV written by writeTrajectory, empty where there were none
+bool readTrajectory(QString fileName, std::vector<CMS::Point> &trajectory)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&file);
+    in.readLine(); // Header
+    while (!in.atEnd())
+    {
+        QStringList fields = in.readLine().split(",");
+        if (fields.size() != 4)
+            continue;
+        if (fields[2].isEmpty() || fields[3].isEmpty())
+            trajectory.push_back(CMS::Point());
+        else
+            trajectory.push_back(CMS::Point(fields[2].toDouble(), fields[3].toDouble()));
+    }
+    return true;
+}
+
+// Distance between the pointer positions of this run and a reference run of the same input
+void compareTrajectory(std::vector<FrameRecord> &records, std::vector<CMS::Point> &reference, QTextStream &out)
+{
+    std::vector<double> distances;
+    int mismatches = 0;
+    for (size_t i = 0; i < records.size() && i < reference.size(); i++)
+    {
+        if (records[i].pointer.empty() != reference[i].empty())
+            mismatches++;
+        else if (!reference[i].empty())
+        {
+            CMS::Point difference = records[i].pointer - reference[i];
+            distances.push_back(std::sqrt(difference * difference));
+        }
+    }
+    std::sort(distances.begin(), distances.end());
+
+    out << "Reference:   ";
+    if (distances.empty())
+    {
+        out << "no common pointer positions";
+    }
+    else
+    {
+        double total = 0;
+        for (size_t i = 0; i < distances.size(); i++)
+            total += distances[i];
+        out << "distance mean " << total / distances.size()
+            << " px, p99 " << percentile(distances, 99)
+            << " px, max " << distances.back() << " px";
+    }
+    out << " (" << distances.size() << " frames compared, " << mismatches
+        << " moved in only one run)\n";
+}
+
+bool writeTrajectory(QString fileName, std::vector<FrameRecord> &records)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out << "frame,ms,x,y\n";
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        out << i << "," << records[i].millis << ",";
+        if (!records[i].pointer.empty())
+            out << records[i].pointer.X() << "," << records[i].pointer.Y();
+        else
+            out << ",";
+        out << "\n";
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ReplayBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded video through the Camera Mouse Suite tracking pipeline.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Video file or image sequence pattern (e.g. frames/%04d.png).");
+    QCommandLineOption screenOption("screen", "Screen resolution used for the pointer.", "WxH", "1920x1080");
+    QStringList trackers = CMS::TrackingModuleRegistry::instance().getNames();
+    QCommandLineOption trackerOption("tracker", "Tracking module: " + trackers.join(", ") + ", or all of them one after the other.", "name", "template");
+    QCommandLineOption trackerParameterOption("tracker-param", "Parameter of the tracking modules that have it (may be repeated).", "key=value");
+    QCommandLineOption kernelOption("kernel", "SSD kernel of the template tracker: auto, opencv, scalar, sse2, avx2 or neon.", "name", "auto");
+    QCommandLineOption kernelBenchmarkOption("kernel-benchmark", "Only time the SSD kernels against cv::matchTemplate on the input.");
+    QCommandLineOption greyTemplateOption("grey-template", "Match the template tracker on grey instead of colour images.");
+    QCommandLineOption subPixelOption("sub-pixel", "Refine template matches below pixel precision, skipping the full resolution pass when possible.");
+    QCommandLineOption referenceOption("reference", "Compare the pointer trajectory with one written by --trajectory.", "file");
+    QCommandLineOption pointOption("point", "Feature to track, set after the first frame (as if clicked).", "x,y");
+    QCommandLineOption noAutoDetectOption("no-auto-detect", "Disable automatic nose detection.");
+    QCommandLineOption syncDetectionOption("sync-detection", "Run the nose detection on the frame it was started for instead of on its own thread, so that runs are reproducible.");
+    QCommandLineOption fullFaceScanOption("full-face-scan", "Search the whole frame for the face on every detection, not first near where it was last found.");
+    QCommandLineOption equalizeOption("equalize", "Equalize the histogram of each face before searching its features.");
+    QCommandLineOption noMirrorOption("no-mirror", "Do not mirror frames (use if the recording is already mirrored).");
+    QCommandLineOption lumaOption("luma", "Track grey frames, as with a YUV camera.");
+    QCommandLineOption mouseOption("mouse", "Pointer backend: \"record\" only records positions, \"system\" also moves the real pointer (e.g. under Xvfb).", "backend", "record");
+    QCommandLineOption warmupOption("warmup", "Frames excluded from the timing statistics.", "frames", "0");
+    QCommandLineOption maxFramesOption("max-frames", "Stop after this many frames.", "frames", "0");
+    QCommandLineOption trajectoryOption("trajectory", "Write per-frame time and pointer position as CSV.", "file");
+    parser.addOption(screenOption);
+    parser.addOption(trackerOption);
+    parser.addOption(trackerParameterOption);
+    parser.addOption(kernelOption);
+    parser.addOption(kernelBenchmarkOption);
+    parser.addOption(greyTemplateOption);
+    parser.addOption(subPixelOption);
+    parser.addOption(referenceOption);
+    parser.addOption(pointOption);
+    parser.addOption(noAutoDetectOption);
+    parser.addOption(syncDetectionOption);
+    parser.addOption(fullFaceScanOption);
+    parser.addOption(equalizeOption);
+    parser.addOption(noMirrorOption);
+    parser.addOption(lumaOption);
+    parser.addOption(mouseOption);
+    parser.addOption(warmupOption);
+    parser.addOption(maxFramesOption);
+    QCommandLineOption profileOption("profile", "Profile each pipeline stage and write the statistics as CSV.", "file");
+    parser.addOption(trajectoryOption);
+    parser.addOption(profileOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    ReplayOptions options;
+    options.input = parser.positionalArguments().first();
+    if (parser.value(trackerOption) == "all")
+        options.trackers = trackers;
+    else
+        options.trackers << parser.value(trackerOption);
+    // The template tracker options are shorthands for its parameters
+    options.trackerAssignments = parser.values(trackerParameterOption);
+    if (parser.isSet(kernelOption))
+        options.trackerAssignments << "kernel=" + parser.value(kernelOption);
+    if (parser.isSet(greyTemplateOption))
+        options.trackerAssignments << "grey=true";
+    if (parser.isSet(subPixelOption))
+        options.trackerAssignments << "sub-pixel=true";
+    try
+    {
+        // Every parameter must apply to at least one of the trackers
+        QStringList keys;
+        foreach (const QString &tracker, options.trackers)
+        {
+            keys << CMS::TrackingModuleRegistry::instance().getDefaults(tracker).keys();
+            delete CMS::TrackingModuleRegistry::instance().create(tracker, trackerParameters(options, tracker));
+        }
+        foreach (const QString &assignment, options.trackerAssignments)
+        {
+            if (!keys.contains(assignment.section('=', 0, 0)))
+                throw std::invalid_argument("No tracker has the parameter " + assignment.toStdString());
+        }
+    }
+    catch (std::invalid_argument &e)
+    {
+        err << e.what() << "\n";
+        return 1;
+    }
+    options.referenceFile = parser.value(referenceOption);
+    options.autoDetect = !parser.isSet(noAutoDetectOption);
+    options.syncDetection = parser.isSet(syncDetectionOption);
+    options.fullFaceScan = parser.isSet(fullFaceScanOption);
+    options.equalize = parser.isSet(equalizeOption);
+    options.mirror = !parser.isSet(noMirrorOption);
+    options.luma = parser.isSet(lumaOption);
+    options.systemMouse = parser.value(mouseOption) == "system";
+    if (!options.systemMouse && parser.value(mouseOption) != "record")
+    {
+        err << "Invalid mouse backend: " << parser.value(mouseOption) << "\n";
+        return 1;
+    }
+    options.warmupFrames = parser.value(warmupOption).toInt();
+    options.maxFrames = parser.value(maxFramesOption).toInt();
+    options.trajectoryFile = parser.value(trajectoryOption);
+    options.profileFile = parser.value(profileOption);
+    if (!parsePair(parser.value(screenOption), options.screenResolution))
+    {
+        err << "Invalid screen resolution: " << parser.value(screenOption) << "\n";
+        return 1;
+    }
+    if (parser.isSet(pointOption) && !parsePair(parser.value(pointOption), options.initialPoint))
+    {
+        err << "Invalid point: " << parser.value(pointOption) << "\n";
+        return 1;
+    }
+    if (parser.isSet(kernelBenchmarkOption))
+    {
+        if (!benchmarkKernels(options, out))
+        {
+            err << "Could not open " << options.input << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (!options.autoDetect && options.initialPoint.empty())
+    {
+        err << "Nothing will be tracked: pass --point when auto detection is disabled\n";
+        return 1;
+    }
+
+    CMS::Profiler::setEnabled(!options.profileFile.isEmpty());
+
+    std::vector<CMS::Point> reference;
+    if (!options.referenceFile.isEmpty() && !readTrajectory(options.referenceFile, reference))
+    {
+        err << "Could not read " << options.referenceFile << "\n";
+        return 1;
+    }
+
+    foreach (const QString &tracker, options.trackers)
+    {
+        std::vector<FrameRecord> records;
+        QString latency;
+        QString detectionPool;
+        try
+        {
+            if (!replay(options, tracker, records, latency, detectionPool))
+            {
+                err << "Could not open " << options.input << "\n";
+                return 1;
+            }
+        }
+        catch (std::exception &e)
+        {
+            err << e.what() << "\n";
+            return 1;
+        }
+
+        if (options.trackers.size() > 1)
+            out << "Tracker:     " << tracker << " (" << CMS::TrackingModuleRegistry::instance().getDescription(tracker) << ")\n";
+        report(options, records, out);
+        out << "Detect pool: " << detectionPool << "\n";
+        out << "Latency:     " << latency << "\n";
+        if (CMS::Profiler::isEnabled())
+            reportStages(out);
+        if (!options.referenceFile.isEmpty())
+            compareTrajectory(records, reference, out);
+
+        QString trajectoryFile = trackerFileName(options, options.trajectoryFile, tracker);
+        if (!options.trajectoryFile.isEmpty() && !writeTrajectory(trajectoryFile, records))
+        {
+            err << "Could not write " << trajectoryFile << "\n";
+            return 1;
+        }
+        QString profileFile = trackerFileName(options, options.profileFile, tracker);
+        if (!options.profileFile.isEmpty() && !writeProfile(profileFile))
+        {
+            err << "Could not write " << profileFile << "\n";
+            return 1;
+        }
+        if (options.trackers.size() > 1)
+            out << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#-------------------------------------------------
+#                         Camera Mouse Suite
+#  Copyright (C) 2015, Andrew Kurauchi
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-------------------------------------------------
+
+QT       += core gui multimedia
+
+TARGET = ReplayBenchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+CMS_ROOT = $$clean_path($$PWD/..)
+
+include($$CMS_ROOT/common.pri)
+
+INCLUDEPATH += $$CMS_ROOT
+
+# Everything except the GUI (main window, camera surface and widgets)
+SOURCES += $$files($$CMS_ROOT/*.cpp) \
+           *.cpp
+SOURCES -= $$CMS_ROOT/main.cpp \
+           $$CMS_ROOT/MainWindow.cpp \
+           $$CMS_ROOT/VideoManagerSurface.cpp \
+           $$CMS_ROOT/ClickableLabel.cpp
+
+HEADERS += $$files($$CMS_ROOT/*.h) \
+           *.h
+HEADERS -= $$CMS_ROOT/MainWindow.h \
+           $$CMS_ROOT/VideoManagerSurface.h \
+           $$CMS_ROOT/ClickableLabel.h
+
+# Copy haar cascade files
+SRC = $${CMS_ROOT}/cascades
+DEST = $${OUT_PWD}/cascades
+
+win32 {
+CONFIG(debug, debug|release) DEST = $${OUT_PWD}/debug/cascades
+CONFIG(release, debug|release) DEST = $${OUT_PWD}/release/cascades
+
+SRC ~= s,/,\\,g
+DEST ~= s,/,\\,g
+}
+
+copydata.commands = $(COPY_DIR) $$SRC $$DEST
+first.depends = $(first) copydata
+export(first.depends)
+export(copydata.commands)
+QMAKE_EXTRA_TARGETS += first copydata
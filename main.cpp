@@ -16,12 +16,40 @@
  */
 
 #include "MainWindow.h"
+#include "TrackingModuleRegistry.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <stdexcept>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    CMS::TrackingModuleRegistry &registry = CMS::TrackingModuleRegistry::instance();
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption trackerOption("tracker", "Tracking module: " + registry.getNames().join(", ") + " (default: keep the one in the settings).", "name");
+    QCommandLineOption trackerParameterOption("tracker-param", "Parameter of the tracking module (may be repeated).", "key=value");
+    parser.addOption(trackerOption);
+    parser.addOption(trackerParameterOption);
+    parser.process(a);
+
     CMS::MainWindow w;
+    try
+    {
+        // Without options the tracker already created from the settings is kept
+        if (parser.isSet(trackerOption) || parser.isSet(trackerParameterOption))
+        {
+            QString tracker = parser.isSet(trackerOption) ? parser.value(trackerOption) : w.getTracker();
+            w.selectTracker(tracker, registry.parseParameters(tracker, parser.values(trackerParameterOption)));
+        }
+    }
+    catch (std::invalid_argument &e)
+    {
+        QTextStream(stderr) << e.what() << "\n";
+        return 1;
+    }
     w.show();
 
     return a.exec();